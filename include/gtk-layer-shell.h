@@ -87,6 +87,48 @@ typedef enum {
     GTK_LAYER_SHELL_KEYBOARD_MODE_ENTRY_NUMBER = 3, // Should not be used except to get the number of entries
 } GtkLayerShellKeyboardMode;
 
+/**
+ * GtkLayerShellLatencyKind:
+ * @GTK_LAYER_SHELL_LATENCY_KIND_LAYER: Changes made with gtk_layer_set_layer().
+ * @GTK_LAYER_SHELL_LATENCY_KIND_ANCHOR: Changes made with gtk_layer_set_anchor().
+ * @GTK_LAYER_SHELL_LATENCY_KIND_MARGIN: Changes made with gtk_layer_set_margin().
+ * @GTK_LAYER_SHELL_LATENCY_KIND_EXCLUSIVE_ZONE: Changes made with gtk_layer_set_exclusive_zone() or by the automatic
+ * exclusive zone.
+ * @GTK_LAYER_SHELL_LATENCY_KIND_KEYBOARD_MODE: Changes made with gtk_layer_set_keyboard_mode().
+ * @GTK_LAYER_SHELL_LATENCY_KIND_ENTRY_NUMBER: Should not be used except to get the number of entries. (NOTE: may change
+ * in future releases as more entries are added)
+ *
+ * Since: 0.11
+ */
+typedef enum {
+    GTK_LAYER_SHELL_LATENCY_KIND_LAYER,
+    GTK_LAYER_SHELL_LATENCY_KIND_ANCHOR,
+    GTK_LAYER_SHELL_LATENCY_KIND_MARGIN,
+    GTK_LAYER_SHELL_LATENCY_KIND_EXCLUSIVE_ZONE,
+    GTK_LAYER_SHELL_LATENCY_KIND_KEYBOARD_MODE,
+    GTK_LAYER_SHELL_LATENCY_KIND_ENTRY_NUMBER, // Should not be used except to get the number of entries
+} GtkLayerShellLatencyKind;
+
+/**
+ * GtkLayerShellLatencyStage:
+ * @GTK_LAYER_SHELL_LATENCY_STAGE_COMMIT: The change was committed to the surface.
+ * @GTK_LAYER_SHELL_LATENCY_STAGE_CONFIGURE: The first `.configure` event after that commit was received.
+ * @GTK_LAYER_SHELL_LATENCY_STAGE_FRAME: The frame callback requested with that commit was received.
+ * @GTK_LAYER_SHELL_LATENCY_STAGE_PRESENT: That commit was shown on screen, as reported by the compositor. Never
+ * reached if the compositor does not support the presentation time protocol.
+ * @GTK_LAYER_SHELL_LATENCY_STAGE_ENTRY_NUMBER: Should not be used except to get the number of entries. (NOTE: may
+ * change in future releases as more entries are added)
+ *
+ * Since: 0.11
+ */
+typedef enum {
+    GTK_LAYER_SHELL_LATENCY_STAGE_COMMIT,
+    GTK_LAYER_SHELL_LATENCY_STAGE_CONFIGURE,
+    GTK_LAYER_SHELL_LATENCY_STAGE_FRAME,
+    GTK_LAYER_SHELL_LATENCY_STAGE_PRESENT,
+    GTK_LAYER_SHELL_LATENCY_STAGE_ENTRY_NUMBER, // Should not be used except to get the number of entries
+} GtkLayerShellLatencyStage;
+
 /**
  * gtk_layer_get_major_version:
  *
@@ -426,6 +468,393 @@ void gtk_layer_set_respect_close (GtkWindow *window, gboolean respect_close);
  */
 gboolean gtk_layer_get_respect_close (GtkWindow *window);
 
+/**
+ * gtk_layer_set_opaque_region:
+ * @window: A layer surface.
+ * @region: (nullable): The part of @window that is fully opaque, in surface-local coordinates.
+ *
+ * GTK only marks a window opaque when its CSS background is known to be opaque, so the compositor usually has to
+ * blend layer surfaces with whatever is below them. If you know which part of your surface is opaque (such as the
+ * whole of a solid bar or background) setting it here lets the compositor skip drawing and blending that area. The
+ * region is copied. %NULL lets GTK decide again. Turns off gtk_layer_set_auto_opaque_region().
+ *
+ * Drawing transparent pixels inside the opaque region results in undefined (compositor-specific) output.
+ *
+ * Since: 0.11
+ */
+void gtk_layer_set_opaque_region (GtkWindow *window, const cairo_region_t *region);
+
+/**
+ * gtk_layer_set_auto_opaque_region:
+ * @window: A layer surface.
+ * @auto_opaque_region: If to mark the whole surface as opaque.
+ *
+ * Like calling gtk_layer_set_opaque_region() with the surface's full size, but kept up to date every time the surface
+ * is configured or allocated a new size. Useful for bars and backgrounds that draw every pixel. Margins are space the
+ * compositor leaves around the surface, and never count as part of it. Clears any explicit opaque region.
+ *
+ * Default is %FALSE
+ *
+ * Since: 0.11
+ */
+void gtk_layer_set_auto_opaque_region (GtkWindow *window, gboolean auto_opaque_region);
+
+/**
+ * gtk_layer_get_auto_opaque_region:
+ * @window: A layer surface.
+ *
+ * Returns: if the whole surface is automatically marked as opaque, see gtk_layer_set_auto_opaque_region()
+ *
+ * Since: 0.11
+ */
+gboolean gtk_layer_get_auto_opaque_region (GtkWindow *window);
+
+/**
+ * gtk_layer_set_input_region:
+ * @window: A layer surface.
+ * @region: (nullable): The part of @window that accepts pointer and touch input, in surface-local coordinates.
+ *
+ * Pointer and touch events outside of @region go to whatever is below @window, and never wake up the app. The
+ * region is copied, and kept when the surface is remapped. %NULL makes the whole surface accept input again. Turns
+ * off gtk_layer_set_click_through(). Keyboard input is not affected, see gtk_layer_set_keyboard_mode().
+ *
+ * Since: 0.11
+ */
+void gtk_layer_set_input_region (GtkWindow *window, const cairo_region_t *region);
+
+/**
+ * gtk_layer_set_click_through:
+ * @window: A layer surface.
+ * @click_through: If @window should get no pointer or touch input.
+ *
+ * Same as gtk_layer_set_input_region() with an empty region. Useful for overlays such as OSDs and watermarks that
+ * cover an output but should never be interacted with. Clears any explicit input region.
+ *
+ * Default is %FALSE
+ *
+ * Since: 0.11
+ */
+void gtk_layer_set_click_through (GtkWindow *window, gboolean click_through);
+
+/**
+ * gtk_layer_get_click_through:
+ * @window: A layer surface.
+ *
+ * Returns: if @window is click-through, see gtk_layer_set_click_through()
+ *
+ * Since: 0.11
+ */
+gboolean gtk_layer_get_click_through (GtkWindow *window);
+
+/**
+ * gtk_layer_set_solid_color:
+ * @window: A layer surface.
+ * @color: (nullable): The color to fill @window with.
+ *
+ * Makes @window show nothing but @color, which is useful for backdrops and letterboxing. The compositor stretches a
+ * single pixel over the whole surface, so this takes next to no memory and no rendering no matter the size. GTK
+ * stops drawing @window (its child widgets are still laid out, but are not shown). Anchors, margins, the exclusive
+ * zone, the layer and all other layer surface properties work as usual. %NULL goes back to drawing the window with
+ * GTK.
+ *
+ * Requires a compositor that supports the single pixel buffer and viewporter protocols. If it doesn't, a warning is
+ * shown and GTK keeps drawing the window.
+ *
+ * Since: 0.11
+ */
+void gtk_layer_set_solid_color (GtkWindow *window, const GdkRGBA *color);
+
+/**
+ * GtkLayerBufferReleaseFunc:
+ * @user_data: The data passed to gtk_layer_attach_buffer().
+ *
+ * Called once neither gtk-layer-shell nor the compositor use a buffer passed to gtk_layer_attach_buffer() anymore.
+ * After this its memory can be reused or freed.
+ *
+ * Since: 0.11
+ */
+typedef void (*GtkLayerBufferReleaseFunc) (gpointer user_data);
+
+/**
+ * gtk_layer_attach_buffer:
+ * @window: A layer surface.
+ * @fd: Shared memory of at least @stride × @height bytes holding the pixels, such as from memfd_create().
+ * @stride: Bytes from the start of one row to the start of the next, at least @width times the bytes per pixel of
+ *   @format.
+ * @format: A wl_shm pixel format the compositor supports. `WL_SHM_FORMAT_ARGB8888` (0) and `WL_SHM_FORMAT_XRGB8888`
+ *   (1) always are. Only packed RGB formats of 2, 3 or 4 bytes per pixel can be attached.
+ * @width: Width of the buffer in pixels.
+ * @height: Height of the buffer in pixels.
+ * @release_func: (nullable) (scope async): Called once the buffer's memory is no longer used.
+ * @user_data: (closure release_func): Passed to @release_func.
+ *
+ * Shows the pixels in @fd on @window, without copying them and without GTK drawing @window. Apps that render their
+ * own content (such as video frames) can use this to skip GTK's buffers entirely. The buffer is stretched over the
+ * whole surface, so it can be of any size (for example the surface size times gtk_layer_get_preferred_scale()).
+ * Anchors, margins, the exclusive zone, the layer and all other layer surface properties work as usual, and the
+ * buffer is shown again if @window is remapped.
+ *
+ * @fd is not taken, and can be closed once this returns. The pixels must not change until @release_func is called.
+ * Calling this again replaces the buffer, and the old one is released once the compositor is done with it. Takes
+ * precedence over gtk_layer_set_solid_color().
+ *
+ * Requires a compositor that supports the viewporter protocol.
+ *
+ * Returns: %TRUE if the buffer is now shown. If %FALSE, a warning is shown and @release_func is never called.
+ *
+ * Since: 0.11
+ */
+gboolean gtk_layer_attach_buffer (GtkWindow *window,
+                                  int fd,
+                                  int stride,
+                                  guint32 format,
+                                  int width,
+                                  int height,
+                                  GtkLayerBufferReleaseFunc release_func,
+                                  gpointer user_data);
+
+/**
+ * gtk_layer_detach_buffer:
+ * @window: A layer surface.
+ *
+ * Stops showing the buffer passed to gtk_layer_attach_buffer(), and goes back to drawing @window with GTK (or with
+ * the color set with gtk_layer_set_solid_color()). The buffer is released once the compositor is done with it. Does
+ * nothing if there is no buffer.
+ *
+ * Since: 0.11
+ */
+void gtk_layer_detach_buffer (GtkWindow *window);
+
+/**
+ * gtk_layer_set_static_content:
+ * @window: A layer surface.
+ * @static_content: If @window's content only changes when you say so.
+ *
+ * For windows such as wallpapers that look the same after their first paint. GTK paints and commits @window once,
+ * and then stops painting it. Invalidations (such as from widgets redrawing themselves) are ignored until
+ * gtk_layer_mark_content_dirty() is called. Resizing the window (for example because the compositor configured it to
+ * a new size) renders it once more. Changes to layer surface properties are still committed, without repainting.
+ *
+ * Default is %FALSE
+ *
+ * Since: 0.11
+ */
+void gtk_layer_set_static_content (GtkWindow *window, gboolean static_content);
+
+/**
+ * gtk_layer_get_static_content:
+ * @window: A layer surface.
+ *
+ * Returns: if @window is in static content mode, see gtk_layer_set_static_content()
+ *
+ * Since: 0.11
+ */
+gboolean gtk_layer_get_static_content (GtkWindow *window);
+
+/**
+ * gtk_layer_mark_content_dirty:
+ * @window: A layer surface.
+ *
+ * Lets a window in static content mode (see gtk_layer_set_static_content()) be painted once more, including
+ * everything that was invalidated since it was last painted. Does nothing if @window is not in static content mode.
+ *
+ * Since: 0.11
+ */
+void gtk_layer_mark_content_dirty (GtkWindow *window);
+
+/**
+ * gtk_layer_set_max_frame_rate:
+ * @window: A layer surface.
+ * @frame_rate: The most frames per second @window is drawn at, or 0 for no limit.
+ *
+ * For windows such as clocks and system monitors that don't need to be redrawn as often as their widgets ask for.
+ * After each frame, GTK is kept from drawing @window until 1/@frame_rate seconds have passed. Everything invalidated
+ * in the meantime is drawn together in the next frame, which is still synchronized to the compositor's frame
+ * callbacks. Changes to layer surface properties are committed right away, without drawing.
+ *
+ * Default is 0
+ *
+ * Since: 0.11
+ */
+void gtk_layer_set_max_frame_rate (GtkWindow *window, guint frame_rate);
+
+/**
+ * gtk_layer_get_max_frame_rate:
+ * @window: A layer surface.
+ *
+ * Returns: the frame rate cap of @window, see gtk_layer_set_max_frame_rate()
+ *
+ * Since: 0.11
+ */
+guint gtk_layer_get_max_frame_rate (GtkWindow *window);
+
+/**
+ * gtk_layer_get_skipped_frame_count:
+ * @window: A layer surface.
+ *
+ * Returns: how many frames GTK wanted to draw @window in while held back by gtk_layer_set_max_frame_rate(), counting
+ * at most one per refresh interval of the output.
+ *
+ * Since: 0.11
+ */
+guint gtk_layer_get_skipped_frame_count (GtkWindow *window);
+
+/**
+ * gtk_layer_get_preferred_scale:
+ * @window: A layer surface.
+ *
+ * GTK 3 can only render at integer scales, so on an output with a fractional scale such as 1.5 it renders at the
+ * next integer up and the compositor scales the result down. Apps that draw their own buffers (for example with
+ * OpenGL) can use this to render at exactly the scale the compositor wants instead. Only known once @window has been
+ * mapped on a compositor that supports the fractional scale protocol.
+ *
+ * Returns: the scale the compositor prefers @window to be rendered at (such as 1.5), or 0 if not known.
+ *
+ * Since: 0.11
+ */
+double gtk_layer_get_preferred_scale (GtkWindow *window);
+
+/**
+ * GtkLayerPresentationFunc:
+ * @window: The layer surface that was committed.
+ * @latency: Microseconds from the commit until it was shown on screen, or -1 if it never was (for example because a
+ *   newer commit replaced it first).
+ * @refresh_interval: Microseconds between refreshes of the output it was shown on, or 0 if not known.
+ * @missed_frames: How many refreshes went by after the commit before it was shown, 0 if it made the first one.
+ * @user_data: The data passed to gtk_layer_set_presentation_callback().
+ *
+ * Since: 0.11
+ */
+typedef void (*GtkLayerPresentationFunc) (GtkWindow *window,
+                                          gint64 latency,
+                                          gint64 refresh_interval,
+                                          guint missed_frames,
+                                          gpointer user_data);
+
+/**
+ * gtk_layer_set_presentation_callback:
+ * @window: A layer surface.
+ * @callback: (nullable) (scope forever): Called once for each commit of @window, or %NULL to stop.
+ * @user_data: (closure callback): Passed to @callback.
+ *
+ * Asks the compositor to report when each commit of @window reaches the screen, whether it is a frame drawn by GTK or
+ * only a change to layer surface properties. This can be used to check that something like an on-screen display
+ * meets a latency target. Requires a compositor that supports the presentation time protocol, if it doesn't
+ * @callback is never called. Changes timed by gtk_layer_get_latency_percentile() also reach
+ * %GTK_LAYER_SHELL_LATENCY_STAGE_PRESENT through the same feedback, without needing a callback.
+ *
+ * Since: 0.11
+ */
+void gtk_layer_set_presentation_callback (GtkWindow *window, GtkLayerPresentationFunc callback, gpointer user_data);
+
+/**
+ * GtkLayerSuspendedFunc:
+ * @window: The layer surface.
+ * @suspended: If @window is now suspended.
+ * @user_data: The data passed to gtk_layer_set_suspended_callback().
+ *
+ * Since: 0.11
+ */
+typedef void (*GtkLayerSuspendedFunc) (GtkWindow *window, gboolean suspended, gpointer user_data);
+
+/**
+ * gtk_layer_set_suspended_callback:
+ * @window: A layer surface.
+ * @callback: (nullable) (scope forever): Called when @window is suspended or stops being suspended, or %NULL to stop.
+ * @user_data: (closure callback): Passed to @callback.
+ *
+ * A window is suspended while the compositor is not showing it, for example because its output is powered off or a
+ * fullscreen window covers it. Apps can use this to stop timers and other work that only matters while the window is
+ * visible. Suspension is detected from the compositor not sending a frame callback within a second of a commit, so it
+ * is only noticed once @window tries to draw. It ends as soon as the compositor sends one. It is only detected while
+ * a callback is set or gtk_layer_set_pause_when_suspended() is enabled. Unmapping @window ends suspension without
+ * calling @callback.
+ *
+ * Since: 0.11
+ */
+void gtk_layer_set_suspended_callback (GtkWindow *window, GtkLayerSuspendedFunc callback, gpointer user_data);
+
+/**
+ * gtk_layer_get_suspended:
+ * @window: A layer surface.
+ *
+ * Returns: if @window is currently suspended, see gtk_layer_set_suspended_callback()
+ *
+ * Since: 0.11
+ */
+gboolean gtk_layer_get_suspended (GtkWindow *window);
+
+/**
+ * gtk_layer_set_pause_when_suspended:
+ * @window: A layer surface.
+ * @pause: If GTK should stop drawing @window while it is suspended.
+ *
+ * While @window is suspended (see gtk_layer_set_suspended_callback()), GTK does not draw it. Everything invalidated
+ * in the meantime is drawn together once it stops being suspended. Changes to layer surface properties are still
+ * committed, without drawing.
+ *
+ * Default is %FALSE
+ *
+ * Since: 0.11
+ */
+void gtk_layer_set_pause_when_suspended (GtkWindow *window, gboolean pause);
+
+/**
+ * gtk_layer_get_pause_when_suspended:
+ * @window: A layer surface.
+ *
+ * Returns: if GTK stops drawing @window while it is suspended, see gtk_layer_set_pause_when_suspended()
+ *
+ * Since: 0.11
+ */
+gboolean gtk_layer_get_pause_when_suspended (GtkWindow *window);
+
+/**
+ * gtk_layer_get_trace:
+ *
+ * When the `GTK_LAYER_SHELL_TRACE` environment variable is set to `1`, gtk-layer-shell records state changes,
+ * requests, configures, acks, commits, presentations and remaps into a fixed-size in-memory ring buffer. Presentations
+ * are only recorded for windows with a presentation callback, or while the latency probe tracks a change. Each event
+ * has a monotonic timestamp (in microseconds) and the ID of the surface it belongs to. This returns the events
+ * currently in the buffer, oldest first, as a JSON object. The same JSON is written to stderr when the process
+ * receives `SIGUSR2`.
+ *
+ * Returns: (transfer full) (nullable): a newly allocated JSON string, or %NULL if tracing is not enabled.
+ *
+ * Since: 0.11
+ */
+char *gtk_layer_get_trace (void);
+
+/**
+ * gtk_layer_get_latency_percentile:
+ * @kind: The kind of state change.
+ * @stage: How far the change has to have progressed.
+ * @percentile: Between 0 and 100, for example 50 for the median or 99 for the tail.
+ *
+ * When the `GTK_LAYER_SHELL_LATENCY_PROBE` environment variable is set to `1`, each `gtk_layer_set_*()` call that
+ * changes the state of a mapped surface is timestamped, and the time until each #GtkLayerShellLatencyStage is reached
+ * is recorded. Only the most recent samples of each kind are kept. Samples are also written to the trace (see
+ * gtk_layer_get_trace()) if it is enabled.
+ *
+ * Returns: the latency in microseconds, or -1 if the probe is disabled or there are no samples.
+ *
+ * Since: 0.11
+ */
+gint64 gtk_layer_get_latency_percentile (GtkLayerShellLatencyKind kind,
+                                         GtkLayerShellLatencyStage stage,
+                                         double percentile);
+
+/**
+ * gtk_layer_get_latency_sample_count:
+ * @kind: The kind of state change.
+ * @stage: How far the change has to have progressed.
+ *
+ * Returns: the number of samples gtk_layer_get_latency_percentile() currently has to work with.
+ *
+ * Since: 0.11
+ */
+guint gtk_layer_get_latency_sample_count (GtkLayerShellLatencyKind kind, GtkLayerShellLatencyStage stage);
+
 G_END_DECLS
 
 #endif // GTK_LAYER_SHELL_H
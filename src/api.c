@@ -15,6 +15,8 @@
 #include "simple-conversions.h"
 #include "layer-surface.h"
 #include "xdg-toplevel-surface.h"
+#include "trace.h"
+#include "latency-probe.h"
 
 #include <gdk/gdkwayland.h>
 
@@ -287,3 +289,201 @@ gboolean gtk_layer_get_respect_close (GtkWindow *window)
     if (!layer_surface) return default_respect_surface_closed; // Error message already shown in gtk_window_get_layer_surface
     return layer_surface->respect_surface_closed;
 }
+
+void
+gtk_layer_set_opaque_region (GtkWindow *window, const cairo_region_t *region)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return; // Error message already shown in gtk_window_get_layer_surface
+    layer_surface_set_opaque_region (layer_surface, region);
+}
+
+void
+gtk_layer_set_auto_opaque_region (GtkWindow *window, gboolean auto_opaque_region)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return; // Error message already shown in gtk_window_get_layer_surface
+    layer_surface_set_auto_opaque_region (layer_surface, auto_opaque_region);
+}
+
+gboolean
+gtk_layer_get_auto_opaque_region (GtkWindow *window)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return FALSE; // Error message already shown in gtk_window_get_layer_surface
+    return layer_surface->auto_opaque_region;
+}
+
+void
+gtk_layer_set_input_region (GtkWindow *window, const cairo_region_t *region)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return; // Error message already shown in gtk_window_get_layer_surface
+    layer_surface_set_input_region (layer_surface, region);
+}
+
+void
+gtk_layer_set_click_through (GtkWindow *window, gboolean click_through)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return; // Error message already shown in gtk_window_get_layer_surface
+    layer_surface_set_click_through (layer_surface, click_through);
+}
+
+gboolean
+gtk_layer_get_click_through (GtkWindow *window)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return FALSE; // Error message already shown in gtk_window_get_layer_surface
+    return layer_surface->click_through;
+}
+
+void
+gtk_layer_set_solid_color (GtkWindow *window, const GdkRGBA *color)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return; // Error message already shown in gtk_window_get_layer_surface
+    layer_surface_set_solid_color (layer_surface, color);
+}
+
+gboolean
+gtk_layer_attach_buffer (GtkWindow *window,
+                         int fd,
+                         int stride,
+                         guint32 format,
+                         int width,
+                         int height,
+                         GtkLayerBufferReleaseFunc release_func,
+                         gpointer user_data)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return FALSE; // Error message already shown in gtk_window_get_layer_surface
+    return layer_surface_attach_buffer (layer_surface, fd, stride, format, width, height, release_func, user_data);
+}
+
+void
+gtk_layer_detach_buffer (GtkWindow *window)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return; // Error message already shown in gtk_window_get_layer_surface
+    layer_surface_detach_buffer (layer_surface);
+}
+
+void
+gtk_layer_set_static_content (GtkWindow *window, gboolean static_content)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return; // Error message already shown in gtk_window_get_layer_surface
+    custom_shell_surface_set_static_content ((CustomShellSurface *)layer_surface, static_content != FALSE);
+}
+
+gboolean
+gtk_layer_get_static_content (GtkWindow *window)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return FALSE; // Error message already shown in gtk_window_get_layer_surface
+    return custom_shell_surface_get_static_content ((CustomShellSurface *)layer_surface);
+}
+
+void
+gtk_layer_mark_content_dirty (GtkWindow *window)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return; // Error message already shown in gtk_window_get_layer_surface
+    custom_shell_surface_mark_content_dirty ((CustomShellSurface *)layer_surface);
+}
+
+void
+gtk_layer_set_max_frame_rate (GtkWindow *window, guint frame_rate)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return; // Error message already shown in gtk_window_get_layer_surface
+    custom_shell_surface_set_max_frame_rate ((CustomShellSurface *)layer_surface, frame_rate);
+}
+
+guint
+gtk_layer_get_max_frame_rate (GtkWindow *window)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return 0; // Error message already shown in gtk_window_get_layer_surface
+    return custom_shell_surface_get_max_frame_rate ((CustomShellSurface *)layer_surface);
+}
+
+guint
+gtk_layer_get_skipped_frame_count (GtkWindow *window)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return 0; // Error message already shown in gtk_window_get_layer_surface
+    return custom_shell_surface_get_skipped_frame_count ((CustomShellSurface *)layer_surface);
+}
+
+void
+gtk_layer_set_presentation_callback (GtkWindow *window, GtkLayerPresentationFunc callback, gpointer user_data)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return; // Error message already shown in gtk_window_get_layer_surface
+    custom_shell_surface_set_presentation_func ((CustomShellSurface *)layer_surface, callback, user_data);
+}
+
+void
+gtk_layer_set_suspended_callback (GtkWindow *window, GtkLayerSuspendedFunc callback, gpointer user_data)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return; // Error message already shown in gtk_window_get_layer_surface
+    custom_shell_surface_set_suspended_func ((CustomShellSurface *)layer_surface, callback, user_data);
+}
+
+gboolean
+gtk_layer_get_suspended (GtkWindow *window)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return FALSE; // Error message already shown in gtk_window_get_layer_surface
+    return custom_shell_surface_get_suspended ((CustomShellSurface *)layer_surface);
+}
+
+void
+gtk_layer_set_pause_when_suspended (GtkWindow *window, gboolean pause)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return; // Error message already shown in gtk_window_get_layer_surface
+    custom_shell_surface_set_pause_when_suspended ((CustomShellSurface *)layer_surface, pause != FALSE);
+}
+
+gboolean
+gtk_layer_get_pause_when_suspended (GtkWindow *window)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return FALSE; // Error message already shown in gtk_window_get_layer_surface
+    return custom_shell_surface_get_pause_when_suspended ((CustomShellSurface *)layer_surface);
+}
+
+double
+gtk_layer_get_preferred_scale (GtkWindow *window)
+{
+    LayerSurface *layer_surface = gtk_window_get_layer_surface (window);
+    if (!layer_surface) return 0; // Error message already shown in gtk_window_get_layer_surface
+    return layer_surface->preferred_scale / 120.0; // The protocol sends it as a numerator over 120
+}
+
+char *
+gtk_layer_get_trace (void)
+{
+    trace_init ();
+    return trace_dump_json ();
+}
+
+gint64
+gtk_layer_get_latency_percentile (GtkLayerShellLatencyKind kind,
+                                  GtkLayerShellLatencyStage stage,
+                                  double percentile)
+{
+    latency_probe_init ();
+    return latency_probe_get_percentile (kind, stage, percentile);
+}
+
+guint
+gtk_layer_get_latency_sample_count (GtkLayerShellLatencyKind kind, GtkLayerShellLatencyStage stage)
+{
+    latency_probe_init ();
+    return latency_probe_get_sample_count (kind, stage);
+}
@@ -12,24 +12,509 @@
 #include "custom-shell-surface.h"
 #include "gtk-wayland.h"
 #include "gtk-priv-access.h"
+#include "profiler.h"
+#include "trace.h"
+#include "latency-probe.h"
+
+#include "presentation-time-client.h"
 
 #include <gtk/gtk.h>
 #include <gdk/gdk.h>
 #include <gdk/gdkwayland.h>
 
 static const char *custom_shell_surface_key = "wayland_custom_shell_surface";
+// How long a frame callback can take before the surface counts as suspended
+static const guint suspend_frame_timeout_ms = 1000;
+
+// The progress of a single state change being tracked by the latency probe
+typedef struct {
+    gint64 change_time; // When the change was made, or 0 if no change of this kind is being tracked
+    gboolean reached[GTK_LAYER_SHELL_LATENCY_STAGE_ENTRY_NUMBER];
+} LatencySequence;
+
+// Presentation feedback requested for a single commit
+typedef struct {
+    CustomShellSurface *shell_surface;
+    struct wp_presentation_feedback *feedback;
+    gint64 commit_time; // Presentation clock time of the commit, or 0 if it has not been made yet
+    gint64 commit_monotonic_time; // Same as above, but in the clock the latency probe uses
+    gboolean latency_tracked; // If the commit carries changes tracked by the latency probe
+} PresentationFeedback;
 
 struct _CustomShellSurfacePrivate
 {
     GtkWindow *gtk_window;
+    guint id; // Unique for the lifetime of the process, used to identify the surface in traces
     CustomShellSurface *popup_parent;
     GList *popup_children;
+    GdkFrameClock *frame_clock; // The frame clock we are connected to (ref held), or NULL
+    gboolean gdk_commit_expected; // If GDK had a commit pending at the end of the last frame clock paint
+    gint64 configure_time; // Profiler time the last .configure was handled, or 0 if it has already been committed
+    LatencySequence latency_sequences[GTK_LAYER_SHELL_LATENCY_KIND_ENTRY_NUMBER];
+    struct wl_callback *latency_frame_callback; // Requested with the commit carrying tracked changes, can be NULL
+    GList *presentation_feedbacks; // PresentationFeedbacks the compositor has not sent feedback for yet
+    GtkLayerPresentationFunc presentation_func; // Set by custom_shell_surface_set_presentation_func (), can be NULL
+    gpointer presentation_data;
+    gboolean updates_frozen; // Set by custom_shell_surface_set_updates_frozen ()
+    gboolean static_content; // Set by custom_shell_surface_set_static_content ()
+    gboolean static_content_painted; // If GDK has committed a buffer since the content was last marked dirty
+    GdkWindow *frozen_gdk_window; // The GdkWindow we froze updates on (no ref held, cleared on unrealize), or NULL
+    guint commit_idle_id; // Source of a pending commit, only used while updates are frozen, or 0
+    gboolean frozen_for_content; // If content (not just the frame rate cap) kept updates frozen since the last thaw
+    guint max_frame_rate; // Set by custom_shell_surface_set_max_frame_rate (), 0 if unlimited
+    gint64 last_frame_time; // Monotonic time of the last commit GDK made while the frame rate is capped
+    guint frame_rate_timeout_id; // Source that lifts the frame rate cap's freeze, or 0 if not currently held back
+    gint64 last_skipped_frame; // Refresh interval (counted from last_frame_time) of the last skipped frame, or -1
+    guint skipped_frame_count; // Frames GTK wanted to draw while held back by the frame rate cap
+    gboolean size_changed; // If the size changed and GDK has not committed a buffer of the new size yet
+    GtkLayerSuspendedFunc suspended_func; // Set by custom_shell_surface_set_suspended_func (), can be NULL
+    gpointer suspended_data;
+    gboolean pause_when_suspended; // Set by custom_shell_surface_set_pause_when_suspended ()
+    gboolean suspended; // If the compositor stopped sending frame callbacks (only detected when someone is interested)
+    struct wl_callback *suspend_frame_callback; // Tells if the compositor is still showing the surface, can be NULL
+    guint suspend_timeout_id; // Marks the surface suspended if suspend_frame_callback isn't done in time, or 0
+};
+
+// Records every tracked change that just reached the given stage. Changes only reach later stages after being
+// committed. reach_time is the monotonic time the stage was reached at, or 0 for now.
+static void
+custom_shell_surface_latency_reach_stage (CustomShellSurface *self, GtkLayerShellLatencyStage stage, gint64 reach_time)
+{
+    for (int kind = 0; kind < GTK_LAYER_SHELL_LATENCY_KIND_ENTRY_NUMBER; kind++) {
+        LatencySequence *sequence = &self->private->latency_sequences[kind];
+        if (!sequence->change_time || sequence->reached[stage])
+            continue;
+        if (stage != GTK_LAYER_SHELL_LATENCY_STAGE_COMMIT && !sequence->reached[GTK_LAYER_SHELL_LATENCY_STAGE_COMMIT])
+            continue;
+
+        if (!reach_time)
+            reach_time = g_get_monotonic_time ();
+        gint64 latency = MAX (reach_time - sequence->change_time, 0);
+        latency_probe_add_sample (kind, stage, latency);
+        trace_event (self, TRACE_EVENT_LATENCY, latency_probe_kind_get_name (kind), 2, stage, latency, 0, 0);
+        sequence->reached[stage] = TRUE;
+
+        gboolean complete = TRUE;
+        for (int i = 0; i < GTK_LAYER_SHELL_LATENCY_STAGE_ENTRY_NUMBER; i++) {
+            complete = complete && sequence->reached[i];
+        }
+        if (complete) {
+            *sequence = (LatencySequence){0};
+        }
+    }
+}
+
+static void
+custom_shell_surface_latency_clear (CustomShellSurface *self)
+{
+    memset (self->private->latency_sequences, 0, sizeof (self->private->latency_sequences));
+    g_clear_pointer (&self->private->latency_frame_callback, wl_callback_destroy);
+}
+
+static void
+custom_shell_surface_latency_handle_frame_done (void *data, struct wl_callback *callback, uint32_t _time)
+{
+    CustomShellSurface *self = data;
+    (void)_time;
+
+    g_return_if_fail (self->private->latency_frame_callback == callback);
+    g_clear_pointer (&self->private->latency_frame_callback, wl_callback_destroy);
+    custom_shell_surface_latency_reach_stage (self, GTK_LAYER_SHELL_LATENCY_STAGE_FRAME, 0);
+}
+
+static const struct wl_callback_listener latency_frame_callback_listener = {
+    .done = custom_shell_surface_latency_handle_frame_done,
+};
+
+// If the next commit will carry changes tracked by the latency probe
+static gboolean
+custom_shell_surface_latency_has_uncommitted_changes (CustomShellSurface *self)
+{
+    for (int kind = 0; kind < GTK_LAYER_SHELL_LATENCY_KIND_ENTRY_NUMBER; kind++) {
+        LatencySequence *sequence = &self->private->latency_sequences[kind];
+        if (sequence->change_time && !sequence->reached[GTK_LAYER_SHELL_LATENCY_STAGE_COMMIT])
+            return TRUE;
+    }
+    return FALSE;
+}
+
+// Must be called before the wl_surface is committed. If the commit will carry tracked changes, requests a frame
+// callback with it so we know when the changes have been presented.
+static void
+custom_shell_surface_latency_before_commit (CustomShellSurface *self, struct wl_surface *wl_surface)
+{
+    if (!custom_shell_surface_latency_has_uncommitted_changes (self))
+        return;
+
+    // Any outstanding callback is for an older commit, changes in this one should be timed from its callback instead
+    g_clear_pointer (&self->private->latency_frame_callback, wl_callback_destroy);
+    self->private->latency_frame_callback = wl_surface_frame (wl_surface);
+    wl_callback_add_listener (self->private->latency_frame_callback, &latency_frame_callback_listener, self);
+}
+
+// Takes the feedback out of the surface's list, reports it and frees it. latency is -1 if the commit was discarded.
+static void
+custom_shell_surface_presentation_done (PresentationFeedback *feedback, gint64 latency, gint64 refresh_interval)
+{
+    CustomShellSurface *self = feedback->shell_surface;
+    // A commit shown on the first refresh after it was made has a latency of less than one refresh interval
+    guint missed_frames = (latency > 0 && refresh_interval > 0) ? (guint)(latency / refresh_interval) : 0;
+    trace_event (self, TRACE_EVENT_PRESENT, NULL, 3, latency, refresh_interval, missed_frames, 0);
+    if (latency >= 0 && feedback->latency_tracked && feedback->commit_time) {
+        custom_shell_surface_latency_reach_stage (self,
+                                                  GTK_LAYER_SHELL_LATENCY_STAGE_PRESENT,
+                                                  feedback->commit_monotonic_time + latency);
+    }
+
+    self->private->presentation_feedbacks = g_list_remove (self->private->presentation_feedbacks, feedback);
+    wp_presentation_feedback_destroy (feedback->feedback);
+    g_free (feedback);
+
+    // Called last, since it could do anything (including destroying the window)
+    if (self->private->presentation_func) {
+        self->private->presentation_func (self->private->gtk_window,
+                                          latency,
+                                          refresh_interval,
+                                          missed_frames,
+                                          self->private->presentation_data);
+    }
+}
+
+static void
+custom_shell_surface_presentation_handle_sync_output (void *_data,
+                                                      struct wp_presentation_feedback *_feedback,
+                                                      struct wl_output *_output)
+{
+    (void)_data;
+    (void)_feedback;
+    (void)_output;
+}
+
+static void
+custom_shell_surface_presentation_handle_presented (void *data,
+                                                    struct wp_presentation_feedback *_feedback,
+                                                    uint32_t tv_sec_hi,
+                                                    uint32_t tv_sec_lo,
+                                                    uint32_t tv_nsec,
+                                                    uint32_t refresh,
+                                                    uint32_t _seq_hi,
+                                                    uint32_t _seq_lo,
+                                                    uint32_t _flags)
+{
+    PresentationFeedback *feedback = data;
+    (void)_feedback;
+    (void)_seq_hi;
+    (void)_seq_lo;
+    (void)_flags;
+
+    gint64 present_time = (gint64)(((guint64)tv_sec_hi << 32) | tv_sec_lo) * G_USEC_PER_SEC + tv_nsec / 1000;
+    gint64 latency = feedback->commit_time ? MAX (present_time - feedback->commit_time, 0) : 0;
+    custom_shell_surface_presentation_done (feedback, latency, refresh / 1000);
+}
+
+static void
+custom_shell_surface_presentation_handle_discarded (void *data, struct wp_presentation_feedback *_feedback)
+{
+    (void)_feedback;
+    custom_shell_surface_presentation_done (data, -1, 0);
+}
+
+static const struct wp_presentation_feedback_listener presentation_feedback_listener = {
+    .sync_output = custom_shell_surface_presentation_handle_sync_output,
+    .presented = custom_shell_surface_presentation_handle_presented,
+    .discarded = custom_shell_surface_presentation_handle_discarded,
+};
+
+static void
+custom_shell_surface_presentation_clear (CustomShellSurface *self)
+{
+    while (self->private->presentation_feedbacks) {
+        PresentationFeedback *feedback = self->private->presentation_feedbacks->data;
+        wp_presentation_feedback_destroy (feedback->feedback);
+        g_free (feedback);
+        self->private->presentation_feedbacks = g_list_delete_link (self->private->presentation_feedbacks,
+                                                                    self->private->presentation_feedbacks);
+    }
+}
+
+// Must be called before the wl_surface is committed. Requests presentation feedback for the commit if there is a
+// presentation callback, a tracked change or a trace to report it to.
+static void
+custom_shell_surface_presentation_before_commit (CustomShellSurface *self, struct wl_surface *wl_surface)
+{
+    struct wp_presentation *presentation = gtk_wayland_get_presentation_global ();
+    gboolean latency_tracked = custom_shell_surface_latency_has_uncommitted_changes (self);
+    // Feedback costs an allocation and a round of events per commit, so it is not requested just for the trace
+    if (!presentation || !(self->private->presentation_func || latency_tracked))
+        return;
+
+    PresentationFeedback *feedback = g_new0 (PresentationFeedback, 1);
+    feedback->shell_surface = self;
+    feedback->latency_tracked = latency_tracked;
+    feedback->feedback = wp_presentation_feedback (presentation, wl_surface);
+    wp_presentation_feedback_add_listener (feedback->feedback, &presentation_feedback_listener, feedback);
+    self->private->presentation_feedbacks = g_list_prepend (self->private->presentation_feedbacks, feedback);
+}
+
+// Called whenever a commit to the wl_surface is detected, either made by GDK or by us
+static void
+custom_shell_surface_on_commit (CustomShellSurface *self)
+{
+    trace_event (self, TRACE_EVENT_COMMIT, NULL, 0, 0, 0, 0, 0);
+    // Feedback requested before a commit GDK ended up not making goes with this one instead
+    for (GList *item = self->private->presentation_feedbacks; item; item = item->next) {
+        PresentationFeedback *feedback = item->data;
+        if (!feedback->commit_time) {
+            feedback->commit_time = gtk_wayland_get_presentation_clock_time ();
+            feedback->commit_monotonic_time = g_get_monotonic_time ();
+        }
+    }
+    custom_shell_surface_latency_reach_stage (self, GTK_LAYER_SHELL_LATENCY_STAGE_COMMIT, 0);
+    if (self->private->configure_time) {
+        profiler_add_mark (self->private->configure_time, "configure to commit");
+        self->private->configure_time = 0;
+    }
+}
+
+// If what GDK would draw is not wanted at the moment (as opposed to only being held back by the frame rate cap)
+static gboolean
+custom_shell_surface_get_content_frozen (CustomShellSurface *self)
+{
+    return self->private->updates_frozen || (self->private->static_content && self->private->static_content_painted);
+}
+
+// Brings the freeze count of the current GdkWindow in line with updates_frozen, the static content state and the
+// frame rate cap
+static void
+custom_shell_surface_apply_updates_frozen (CustomShellSurface *self)
+{
+    GdkWindow *gdk_window = gtk_widget_get_window (GTK_WIDGET (self->private->gtk_window));
+    gboolean content_frozen = custom_shell_surface_get_content_frozen (self);
+    // A new size must not be committed with a buffer of the old size, so the frame rate cap and suspension never hold
+    // back the first paint after a resize
+    gboolean frozen = content_frozen ||
+        (!self->private->size_changed &&
+         (self->private->frame_rate_timeout_id != 0 ||
+          (self->private->suspended && self->private->pause_when_suspended)));
+
+    if (self->private->frozen_gdk_window && !frozen) {
+        gdk_window_thaw_updates (self->private->frozen_gdk_window);
+        // If the content was frozen nothing was painted, so the whole window is out of date. The frame rate cap and
+        // suspension only delay painting, so invalidations made in the meantime are drawn together in the next frame.
+        if (self->private->frozen_for_content)
+            gdk_window_invalidate_rect (self->private->frozen_gdk_window, NULL, TRUE);
+        self->private->frozen_gdk_window = NULL;
+        self->private->frozen_for_content = FALSE;
+    }
+
+    if (frozen && gdk_window && !self->private->frozen_gdk_window) {
+        gdk_window_freeze_updates (gdk_window);
+        self->private->frozen_gdk_window = gdk_window;
+    }
+
+    if (self->private->frozen_gdk_window && content_frozen)
+        self->private->frozen_for_content = TRUE;
+}
+
+static gboolean
+custom_shell_surface_on_frame_rate_timeout (gpointer data)
+{
+    CustomShellSurface *self = data;
+    self->private->frame_rate_timeout_id = 0;
+    custom_shell_surface_apply_updates_frozen (self);
+    return G_SOURCE_REMOVE;
+}
+
+// (Re)schedules lifting the frame rate cap's freeze for when the next frame is allowed, or lifts it now if it is
+static void
+custom_shell_surface_update_frame_rate_timeout (CustomShellSurface *self)
+{
+    if (self->private->frame_rate_timeout_id) {
+        g_source_remove (self->private->frame_rate_timeout_id);
+        self->private->frame_rate_timeout_id = 0;
+    }
+
+    if (self->private->max_frame_rate && self->private->last_frame_time) {
+        gint64 next_frame_time = self->private->last_frame_time + G_USEC_PER_SEC / self->private->max_frame_rate;
+        gint64 remaining = next_frame_time - g_get_monotonic_time ();
+        if (remaining > 0) {
+            // Rounded up, so the cap is never exceeded
+            guint remaining_ms = (guint)((remaining + 999) / 1000);
+            self->private->frame_rate_timeout_id = g_timeout_add (remaining_ms,
+                                                                  custom_shell_surface_on_frame_rate_timeout,
+                                                                  self);
+            self->private->last_skipped_frame = -1;
+        }
+    }
+
+    custom_shell_surface_apply_updates_frozen (self);
+}
+
+static void
+custom_shell_surface_set_suspended (CustomShellSurface *self, gboolean suspended)
+{
+    if (self->private->suspended == suspended)
+        return;
+    self->private->suspended = suspended;
+    trace_event (self, TRACE_EVENT_STATE_CHANGE, "suspended", 1, suspended, 0, 0, 0);
+    custom_shell_surface_apply_updates_frozen (self);
+
+    // Called last, since it could do anything (including destroying the window)
+    if (self->private->suspended_func)
+        self->private->suspended_func (self->private->gtk_window, suspended, self->private->suspended_data);
+}
+
+static gboolean
+custom_shell_surface_on_suspend_timeout (gpointer data)
+{
+    CustomShellSurface *self = data;
+    self->private->suspend_timeout_id = 0;
+    custom_shell_surface_set_suspended (self, TRUE);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+custom_shell_surface_suspend_clear (CustomShellSurface *self)
+{
+    g_clear_pointer (&self->private->suspend_frame_callback, wl_callback_destroy);
+    if (self->private->suspend_timeout_id) {
+        g_source_remove (self->private->suspend_timeout_id);
+        self->private->suspend_timeout_id = 0;
+    }
+}
+
+static void
+custom_shell_surface_suspend_handle_frame_done (void *data, struct wl_callback *callback, uint32_t _time)
+{
+    CustomShellSurface *self = data;
+    (void)_time;
+
+    g_return_if_fail (self->private->suspend_frame_callback == callback);
+    custom_shell_surface_suspend_clear (self);
+    custom_shell_surface_set_suspended (self, FALSE);
+}
+
+static const struct wl_callback_listener suspend_frame_callback_listener = {
+    .done = custom_shell_surface_suspend_handle_frame_done,
 };
 
+// Must be called before the wl_surface is committed. If anyone is interested in the suspended state, requests a frame
+// callback with the commit. Compositors stop sending frame callbacks to surfaces that are not being shown (because
+// their output is off or they are covered), so if it does not come in time the surface is suspended.
+static void
+custom_shell_surface_suspend_before_commit (CustomShellSurface *self, struct wl_surface *wl_surface)
+{
+    if (!self->private->suspended_func && !self->private->pause_when_suspended)
+        return;
+    // An outstanding callback answers the same question
+    if (self->private->suspend_frame_callback)
+        return;
+
+    self->private->suspend_frame_callback = wl_surface_frame (wl_surface);
+    wl_callback_add_listener (self->private->suspend_frame_callback, &suspend_frame_callback_listener, self);
+    self->private->suspend_timeout_id = g_timeout_add (suspend_frame_timeout_ms,
+                                                       custom_shell_surface_on_suspend_timeout,
+                                                       self);
+}
+
+// Invalidate handler of the GdkWindow, counts frames skipped because of the frame rate cap
+static void
+custom_shell_surface_on_invalidate (GdkWindow *gdk_window, cairo_region_t *_region)
+{
+    (void)_region;
+
+    gpointer widget = NULL;
+    gdk_window_get_user_data (gdk_window, &widget);
+    CustomShellSurface *self = GTK_IS_WINDOW (widget) ? gtk_window_get_custom_shell_surface (widget) : NULL;
+    if (!self || !self->private->frozen_gdk_window || !self->private->frame_rate_timeout_id ||
+        custom_shell_surface_get_content_frozen (self))
+        return;
+
+    // Without the cap, all invalidations within one refresh interval would have been drawn in a single frame
+    gint64 refresh_interval = 0;
+    GdkFrameClock *frame_clock = self->private->frame_clock;
+    if (frame_clock)
+        gdk_frame_clock_get_refresh_info (frame_clock, gdk_frame_clock_get_frame_time (frame_clock),
+                                          &refresh_interval, NULL);
+    if (refresh_interval <= 0)
+        refresh_interval = G_USEC_PER_SEC / 60;
+
+    gint64 frame = (g_get_monotonic_time () - self->private->last_frame_time) / refresh_interval;
+    if (frame != self->private->last_skipped_frame) {
+        self->private->last_skipped_frame = frame;
+        self->private->skipped_frame_count++;
+    }
+}
+
+static void
+custom_shell_surface_on_frame_clock_paint (GdkFrameClock *_frame_clock, CustomShellSurface *self)
+{
+    (void)_frame_clock;
+
+    // GDK paints (and decides if it needs to commit) in its own paint handler, which runs before this one
+    GdkWindow *gdk_window = gtk_widget_get_window (GTK_WIDGET (self->private->gtk_window));
+    self->private->gdk_commit_expected = gdk_window && gdk_window_get_priv_pending_commit (gdk_window);
+
+    if (self->private->gdk_commit_expected) {
+        struct wl_surface *wl_surface = gdk_wayland_window_get_wl_surface (gdk_window);
+        if (wl_surface) {
+            custom_shell_surface_presentation_before_commit (self, wl_surface);
+            custom_shell_surface_latency_before_commit (self, wl_surface);
+            custom_shell_surface_suspend_before_commit (self, wl_surface);
+        }
+    }
+}
+
+static void
+custom_shell_surface_on_frame_clock_after_paint (GdkFrameClock *_frame_clock, CustomShellSurface *self)
+{
+    (void)_frame_clock;
+
+    // GDK commits in its own after-paint handler, which runs before this one. If the commit is still pending then
+    // updates are frozen and GDK did not commit.
+    GdkWindow *gdk_window = gtk_widget_get_window (GTK_WIDGET (self->private->gtk_window));
+    if (self->private->gdk_commit_expected && gdk_window && !gdk_window_get_priv_pending_commit (gdk_window)) {
+        custom_shell_surface_on_commit (self);
+        if (self->private->size_changed) {
+            self->private->size_changed = FALSE;
+            custom_shell_surface_apply_updates_frozen (self);
+        }
+        if (self->private->static_content && !self->private->static_content_painted) {
+            // That was the one paint static content gets, stop GDK from painting until the content is dirty again
+            self->private->static_content_painted = TRUE;
+            custom_shell_surface_apply_updates_frozen (self);
+        }
+        if (self->private->max_frame_rate) {
+            // Hold GDK back until the next frame is allowed
+            self->private->last_frame_time = g_get_monotonic_time ();
+            custom_shell_surface_update_frame_rate_timeout (self);
+        }
+    }
+    self->private->gdk_commit_expected = FALSE;
+}
+
+static void
+custom_shell_surface_disconnect_frame_clock (CustomShellSurface *self)
+{
+    if (self->private->frame_clock) {
+        g_signal_handlers_disconnect_by_data (self->private->frame_clock, self);
+        g_clear_object (&self->private->frame_clock);
+    }
+    self->private->gdk_commit_expected = FALSE;
+}
+
 static void
 custom_shell_surface_on_window_destroy (CustomShellSurface *self)
 {
     self->virtual->finalize (self);
+    custom_shell_surface_disconnect_frame_clock (self);
+    custom_shell_surface_latency_clear (self);
+    custom_shell_surface_presentation_clear (self);
+    custom_shell_surface_suspend_clear (self);
+    if (self->private->commit_idle_id)
+        g_source_remove (self->private->commit_idle_id);
+    if (self->private->frame_rate_timeout_id)
+        g_source_remove (self->private->frame_rate_timeout_id);
 
     if (self->private->popup_parent) {
         g_warning ("Shell surface has popup parent on finalize (should have been cleared by unmap)");
@@ -59,6 +544,27 @@ custom_shell_surface_on_window_realize (GtkWidget *widget, CustomShellSurface *s
 
     gtk_priv_access_init (gdk_window);
     gdk_wayland_window_set_use_custom_surface (gdk_window);
+
+    // Connected after GDK's own handlers, which were connected when the GdkWindow was created
+    custom_shell_surface_disconnect_frame_clock (self);
+    GdkFrameClock *frame_clock = gdk_window_get_frame_clock (gdk_window);
+    if (frame_clock) {
+        self->private->frame_clock = g_object_ref (frame_clock);
+        g_signal_connect (frame_clock, "paint", G_CALLBACK (custom_shell_surface_on_frame_clock_paint), self);
+        g_signal_connect (frame_clock, "after-paint", G_CALLBACK (custom_shell_surface_on_frame_clock_after_paint), self);
+    }
+    gdk_window_set_invalidate_handler (gdk_window, custom_shell_surface_on_invalidate);
+
+    custom_shell_surface_apply_updates_frozen (self);
+}
+
+static void
+custom_shell_surface_on_window_unrealize (GtkWidget *widget, CustomShellSurface *self)
+{
+    g_return_if_fail (GTK_WIDGET (self->private->gtk_window) == widget);
+    custom_shell_surface_disconnect_frame_clock (self);
+    // The GdkWindow is about to be destroyed, a new one is frozen on the next realize
+    self->private->frozen_gdk_window = NULL;
 }
 
 static void
@@ -79,12 +585,18 @@ custom_shell_surface_on_window_map (GtkWidget *widget, CustomShellSurface *self)
     wl_surface_attach (wl_surface, NULL, 0, 0);
 
     self->awaiting_initial_configure = FALSE;
+    trace_event (self, TRACE_EVENT_MAP, NULL, 0, 0, 0, 0, 0);
+    // The new wl_surface needs a buffer, which should not be held back by the frame rate cap
+    self->private->last_frame_time = 0;
+    custom_shell_surface_update_frame_rate_timeout (self);
+    custom_shell_surface_mark_content_dirty (self);
     self->virtual->map (self, wl_surface);
     gdk_window_set_priv_mapped (gdk_window);
 
     wl_surface_commit (wl_surface);
 
     struct wl_display *display = gdk_wayland_display_get_wl_display (gdk_display_get_default ());
+    gint64 profiler_start_time = profiler_current_time ();
     gint64 start_time_micro = g_get_monotonic_time();
     while (self->awaiting_initial_configure) {
         wl_display_roundtrip (display);
@@ -94,6 +606,7 @@ custom_shell_surface_on_window_map (GtkWidget *widget, CustomShellSurface *self)
             break;
         }
     }
+    profiler_add_mark (profiler_start_time, "initial configure wait");
 }
 
 void
@@ -101,8 +614,11 @@ custom_shell_surface_init (CustomShellSurface *self, GtkWindow *gtk_window)
 {
     g_assert (self->virtual); // Subclass should have set this up first
 
+    static guint next_id = 1;
+
     self->private = g_new0 (CustomShellSurfacePrivate, 1);
     self->private->gtk_window = gtk_window;
+    self->private->id = next_id++;
 
     g_return_if_fail (gtk_window);
     g_return_if_fail (!gtk_widget_get_mapped (GTK_WIDGET (gtk_window)));
@@ -111,6 +627,7 @@ custom_shell_surface_init (CustomShellSurface *self, GtkWindow *gtk_window)
                             self,
                             (GDestroyNotify) custom_shell_surface_on_window_destroy);
     g_signal_connect (gtk_window, "realize", G_CALLBACK (custom_shell_surface_on_window_realize), self);
+    g_signal_connect (gtk_window, "unrealize", G_CALLBACK (custom_shell_surface_on_window_unrealize), self);
     g_signal_connect (gtk_window, "map", G_CALLBACK (custom_shell_surface_on_window_map), self);
 
     if (gtk_widget_get_realized (GTK_WIDGET (gtk_window))) {
@@ -135,6 +652,22 @@ custom_shell_surface_get_gtk_window (CustomShellSurface *self)
     return self->private->gtk_window;
 }
 
+guint
+custom_shell_surface_get_id (CustomShellSurface *self)
+{
+    g_return_val_if_fail (self, 0);
+    return self->private->id;
+}
+
+static gboolean
+custom_shell_surface_on_commit_idle (gpointer data)
+{
+    CustomShellSurface *self = data;
+    self->private->commit_idle_id = 0;
+    custom_shell_surface_force_commit (self);
+    return G_SOURCE_REMOVE;
+}
+
 void
 custom_shell_surface_needs_commit (CustomShellSurface *self)
 {
@@ -146,6 +679,13 @@ custom_shell_surface_needs_commit (CustomShellSurface *self)
     if (!gdk_window)
         return;
 
+    if (self->private->frozen_gdk_window) {
+        // GDK won't paint, so it won't commit either. Commit ourselves once the current batch of changes is made.
+        if (!self->private->commit_idle_id)
+            self->private->commit_idle_id = g_idle_add (custom_shell_surface_on_commit_idle, self);
+        return;
+    }
+
     // Hopefully this will trigger a commit
     // Don't commit directly, as that screws up GTK's internal state
     // (see https://github.com/wmww/gtk-layer-shell/issues/51)
@@ -168,7 +708,147 @@ custom_shell_surface_force_commit (CustomShellSurface *self)
     if (!wl_surface)
         return;
 
+    // Region changes made while updates are frozen would otherwise wait for GDK's next paint
+    gdk_window_sync_priv_regions (gdk_window);
+    custom_shell_surface_presentation_before_commit (self, wl_surface);
+    custom_shell_surface_latency_before_commit (self, wl_surface);
+    custom_shell_surface_suspend_before_commit (self, wl_surface);
     wl_surface_commit (wl_surface);
+    custom_shell_surface_on_commit (self);
+}
+
+void
+custom_shell_surface_set_presentation_func (CustomShellSurface *self,
+                                            GtkLayerPresentationFunc presentation_func,
+                                            gpointer user_data)
+{
+    self->private->presentation_func = presentation_func;
+    self->private->presentation_data = user_data;
+}
+
+void
+custom_shell_surface_set_suspended_func (CustomShellSurface *self,
+                                         GtkLayerSuspendedFunc suspended_func,
+                                         gpointer user_data)
+{
+    self->private->suspended_func = suspended_func;
+    self->private->suspended_data = user_data;
+}
+
+void
+custom_shell_surface_set_pause_when_suspended (CustomShellSurface *self, gboolean pause_when_suspended)
+{
+    if (self->private->pause_when_suspended == pause_when_suspended)
+        return;
+    self->private->pause_when_suspended = pause_when_suspended;
+    trace_event (self, TRACE_EVENT_STATE_CHANGE, "pause-when-suspended", 1, pause_when_suspended, 0, 0, 0);
+    custom_shell_surface_apply_updates_frozen (self);
+}
+
+gboolean
+custom_shell_surface_get_pause_when_suspended (CustomShellSurface *self)
+{
+    return self->private->pause_when_suspended;
+}
+
+gboolean
+custom_shell_surface_get_suspended (CustomShellSurface *self)
+{
+    return self->private->suspended;
+}
+
+void
+custom_shell_surface_set_updates_frozen (CustomShellSurface *self, gboolean frozen)
+{
+    self->private->updates_frozen = frozen;
+    custom_shell_surface_apply_updates_frozen (self);
+}
+
+void
+custom_shell_surface_set_static_content (CustomShellSurface *self, gboolean static_content)
+{
+    if (self->private->static_content == static_content)
+        return;
+    self->private->static_content = static_content;
+    trace_event (self, TRACE_EVENT_STATE_CHANGE, "static-content", 1, static_content, 0, 0, 0);
+    // Make sure what's shown is up to date before freezing
+    self->private->static_content_painted = FALSE;
+    custom_shell_surface_apply_updates_frozen (self);
+    custom_shell_surface_needs_commit (self);
+}
+
+gboolean
+custom_shell_surface_get_static_content (CustomShellSurface *self)
+{
+    return self->private->static_content;
+}
+
+void
+custom_shell_surface_mark_content_dirty (CustomShellSurface *self)
+{
+    if (!self->private->static_content || !self->private->static_content_painted)
+        return;
+    trace_event (self, TRACE_EVENT_STATE_CHANGE, "content-dirty", 0, 0, 0, 0, 0);
+    self->private->static_content_painted = FALSE;
+    custom_shell_surface_apply_updates_frozen (self);
+}
+
+void
+custom_shell_surface_size_changed (CustomShellSurface *self)
+{
+    custom_shell_surface_mark_content_dirty (self);
+    if (self->private->size_changed)
+        return;
+    self->private->size_changed = TRUE;
+    custom_shell_surface_apply_updates_frozen (self);
+}
+
+void
+custom_shell_surface_set_max_frame_rate (CustomShellSurface *self, guint max_frame_rate)
+{
+    if (self->private->max_frame_rate == max_frame_rate)
+        return;
+    self->private->max_frame_rate = max_frame_rate;
+    trace_event (self, TRACE_EVENT_STATE_CHANGE, "max-frame-rate", 1, max_frame_rate, 0, 0, 0);
+    // Applies the new interval to the frame being held back, if any
+    custom_shell_surface_update_frame_rate_timeout (self);
+}
+
+guint
+custom_shell_surface_get_max_frame_rate (CustomShellSurface *self)
+{
+    return self->private->max_frame_rate;
+}
+
+guint
+custom_shell_surface_get_skipped_frame_count (CustomShellSurface *self)
+{
+    return self->private->skipped_frame_count;
+}
+
+void
+custom_shell_surface_handle_configure (CustomShellSurface *self, uint32_t serial)
+{
+    trace_event (self, TRACE_EVENT_ACK, NULL, 1, serial, 0, 0, 0);
+    self->awaiting_initial_configure = FALSE;
+    self->private->configure_time = profiler_current_time ();
+    custom_shell_surface_latency_reach_stage (self, GTK_LAYER_SHELL_LATENCY_STAGE_CONFIGURE, 0);
+}
+
+void
+custom_shell_surface_latency_mark_change (CustomShellSurface *self, GtkLayerShellLatencyKind kind)
+{
+    if (!latency_probe_get_enabled ())
+        return;
+    g_return_if_fail (kind >= 0 && kind < GTK_LAYER_SHELL_LATENCY_KIND_ENTRY_NUMBER);
+
+    LatencySequence *sequence = &self->private->latency_sequences[kind];
+    // Changes that have not been committed yet will go out in the same commit as this one, so keep timing from the
+    // first. Once committed, a new change supersedes whatever stages the old one had left.
+    if (!sequence->change_time || sequence->reached[GTK_LAYER_SHELL_LATENCY_STAGE_COMMIT]) {
+        *sequence = (LatencySequence){0};
+        sequence->change_time = g_get_monotonic_time ();
+    }
 }
 
 void
@@ -181,8 +861,11 @@ custom_shell_surface_remap (CustomShellSurface *self)
     }
     GtkWidget *window_widget = GTK_WIDGET (self->private->gtk_window);
     g_return_if_fail (window_widget);
+    trace_event (self, TRACE_EVENT_REMAP, NULL, 0, 0, 0, 0, 0);
+    gint64 profiler_start_time = profiler_current_time ();
     gtk_widget_hide (window_widget);
     gtk_widget_show (window_widget);
+    profiler_add_mark (profiler_start_time, "remap");
 }
 
 // Calls virtual->get_popup and adds the surface to the list of popups
@@ -218,5 +901,12 @@ void custom_shell_surface_unmap (CustomShellSurface *self)
         parent_private->popup_children = g_list_remove (parent_private->popup_children, self);
         self->private->popup_parent = NULL;
     }
+    trace_event (self, TRACE_EVENT_UNMAP, NULL, 0, 0, 0, 0, 0);
+    custom_shell_surface_latency_clear (self);
+    custom_shell_surface_presentation_clear (self);
+    // An unmapped surface isn't suspended, it isn't there at all. Not reported, as this can happen during destruction.
+    custom_shell_surface_suspend_clear (self);
+    self->private->suspended = FALSE;
+    custom_shell_surface_apply_updates_frozen (self);
     self->virtual->unmap (self);
 }
@@ -14,6 +14,8 @@
 
 #include <gtk/gtk.h>
 #include <gdk/gdk.h>
+#include <stdint.h>
+#include "gtk-layer-shell.h"
 
 struct wl_surface;
 struct xdg_surface;
@@ -60,6 +62,9 @@ CustomShellSurface *gtk_window_get_custom_shell_surface (GtkWindow *gtk_window);
 
 GtkWindow *custom_shell_surface_get_gtk_window (CustomShellSurface *self);
 
+// Returns a small integer that uniquely identifies this surface, never 0
+guint custom_shell_surface_get_id (CustomShellSurface *self);
+
 // Schedules commit on the next frame callback
 // Does nothing is the shell surface does not currently have a GdkWindow with a wl_surface
 void custom_shell_surface_needs_commit (CustomShellSurface *self);
@@ -68,6 +73,50 @@ void custom_shell_surface_needs_commit (CustomShellSurface *self);
 // Does nothing is the shell surface does not currently have a GdkWindow with a wl_surface
 void custom_shell_surface_force_commit (CustomShellSurface *self);
 
+// Requests presentation feedback for every commit (made by GDK or by us) and calls presentation_func with the result.
+// Can be NULL to stop.
+void custom_shell_surface_set_presentation_func (CustomShellSurface *self,
+                                                 GtkLayerPresentationFunc presentation_func,
+                                                 gpointer user_data);
+
+// A surface is suspended when the compositor takes too long to send a frame callback requested with a commit, and
+// stops being suspended once it arrives. Only detected while there is a suspended_func or pause_when_suspended is
+// set. While paused, GDK's updates are frozen (as with custom_shell_surface_set_updates_frozen ()).
+void custom_shell_surface_set_suspended_func (CustomShellSurface *self,
+                                              GtkLayerSuspendedFunc suspended_func,
+                                              gpointer user_data);
+void custom_shell_surface_set_pause_when_suspended (CustomShellSurface *self, gboolean pause_when_suspended);
+gboolean custom_shell_surface_get_pause_when_suspended (CustomShellSurface *self);
+gboolean custom_shell_surface_get_suspended (CustomShellSurface *self);
+
+// Stops GDK from painting (and so from attaching buffers or committing) while frozen, across remaps. While frozen,
+// custom_shell_surface_needs_commit () commits directly from an idle callback. Unfreezing repaints the whole window.
+void custom_shell_surface_set_updates_frozen (CustomShellSurface *self, gboolean frozen);
+
+// In static content mode GDK paints and commits once, then its updates are frozen (as above) until the content is
+// marked dirty, which allows exactly one more paint. Mapping marks the content dirty.
+void custom_shell_surface_set_static_content (CustomShellSurface *self, gboolean static_content);
+gboolean custom_shell_surface_get_static_content (CustomShellSurface *self);
+void custom_shell_surface_mark_content_dirty (CustomShellSurface *self); // Does nothing if not in static mode
+// Should be called by subclasses when the size of the surface changes. Marks the content dirty, and lets GDK paint and
+// commit the new size even if the frame rate cap or suspension is holding it back.
+void custom_shell_surface_size_changed (CustomShellSurface *self);
+
+// Once GDK commits, its updates are frozen (as above) until 1/max_frame_rate seconds have passed. Invalidations made in
+// the meantime are drawn together in the next frame. 0 means unlimited.
+void custom_shell_surface_set_max_frame_rate (CustomShellSurface *self, guint max_frame_rate);
+guint custom_shell_surface_get_max_frame_rate (CustomShellSurface *self);
+// Number of frames (at most one per refresh interval) GTK wanted to draw while the frame rate cap held it back
+guint custom_shell_surface_get_skipped_frame_count (CustomShellSurface *self);
+
+// Should be called by subclasses after they ack a .configure event with the given serial, clears
+// awaiting_initial_configure
+void custom_shell_surface_handle_configure (CustomShellSurface *self, uint32_t serial);
+
+// Starts tracking a state change for the latency probe, should be called after the request carrying it is sent
+// Does nothing if the latency probe is disabled
+void custom_shell_surface_latency_mark_change (CustomShellSurface *self, GtkLayerShellLatencyKind kind);
+
 // Unmap and remap a currently mapped shell surface
 void custom_shell_surface_remap (CustomShellSurface *self);
 
@@ -12,6 +12,7 @@
 #include "gtk-priv-access.h"
 #include "gtk-wayland.h"
 #include "xdg-popup-surface.h"
+#include "profiler.h"
 
 #include "wayland-client.h"
 
@@ -34,6 +35,7 @@ typedef void *GdkWaylandTabletToolData;
 #include "gdk_wayland_tablet_data_priv.h"
 
 #include <glib-2.0/glib.h>
+#include <gdk/gdkwayland.h>
 
 // The type of the function pointer of GdkWindowImpl's move_to_rect method (gdkwindowimpl.h:78)'
 typedef void (*MoveToRectFunc) (GdkWindow *window,
@@ -130,6 +132,7 @@ gdk_window_move_to_rect_impl_override (GdkWindow *window,
                                        int rect_anchor_dx,
                                        int rect_anchor_dy)
 {
+    gint64 profiler_start_time = profiler_current_time ();
     g_assert (gdk_window_move_to_rect_real);
     gdk_window_move_to_rect_real (window,
                                   rect,
@@ -166,6 +169,7 @@ gdk_window_move_to_rect_impl_override (GdkWindow *window,
         };
         gtk_wayland_setup_window_as_custom_popup (window, &position);
     }
+    profiler_add_mark (profiler_start_time, "move to rect override");
 }
 
 void
@@ -192,6 +196,28 @@ gtk_priv_access_init (GdkWindow *gdk_window)
     }
 }
 
+gboolean
+gdk_window_set_priv_initial_scale (GdkWindow *gdk_window, int scale)
+{
+    GdkWindowImplWayland *window_impl = (GdkWindowImplWayland *)gdk_window_priv_get_impl (gdk_window);
+    // Existing cairo surfaces have the old scale baked in, and GDK only replaces them when it changes the scale itself
+    if (gdk_window_impl_wayland_priv_get_staging_cairo_surface (window_impl) ||
+        gdk_window_impl_wayland_priv_get_committed_cairo_surface (window_impl))
+        return FALSE;
+    *gdk_window_impl_wayland_priv_get_scale_ptr (window_impl) = scale;
+
+    // GTK only checks the scale (and notifies scale-factor and drops cached icons and styles) on a configure event. GDK
+    // doesn't send one for a scale it already has, so the wl_surface.enter for the output we guessed won't either.
+    GdkEvent *event = gdk_event_new (GDK_CONFIGURE);
+    event->configure.window = g_object_ref (gdk_window);
+    event->configure.send_event = FALSE;
+    event->configure.width = gdk_window_get_width (gdk_window);
+    event->configure.height = gdk_window_get_height (gdk_window);
+    gdk_event_put (event);
+    gdk_event_free (event);
+    return TRUE;
+}
+
 GdkRectangle
 gtk_window_get_priv_logical_geom (GtkWindow *gtk_window)
 {
@@ -217,3 +243,49 @@ gdk_window_get_priv_pending_commit (GdkWindow *gdk_window)
     return (gdk_window_impl_wayland_priv_get_pending_commit (window_impl) ||
         gdk_window_impl_wayland_priv_get_pending_buffer_attached (window_impl));
 }
+
+// Same as GDK's wl_region_from_cairo_region () (gdkprivate-wayland.h), returns NULL for a NULL region (infinite)
+static struct wl_region *
+wl_region_from_cairo_region (GdkWindow *gdk_window, cairo_region_t *region)
+{
+    if (!region)
+        return NULL;
+
+    GdkDisplay *gdk_display = gdk_window_get_display (gdk_window);
+    struct wl_region *wl_region = wl_compositor_create_region (gdk_wayland_display_get_wl_compositor (gdk_display));
+    for (int i = 0; i < cairo_region_num_rectangles (region); i++) {
+        cairo_rectangle_int_t rect;
+        cairo_region_get_rectangle (region, i, &rect);
+        wl_region_add (wl_region, rect.x, rect.y, rect.width, rect.height);
+    }
+    return wl_region;
+}
+
+void
+gdk_window_sync_priv_regions (GdkWindow *gdk_window)
+{
+    GdkWindowImplWayland *window_impl = (GdkWindowImplWayland *)gdk_window_priv_get_impl (gdk_window);
+    struct wl_surface *wl_surface = gdk_wayland_window_get_wl_surface (gdk_window);
+    if (!wl_surface)
+        return;
+
+    // Mirrors gdk_wayland_window_sync_opaque_region () and gdk_wayland_window_sync_input_region (), clearing the same
+    // dirty flags so GDK doesn't send the regions again when it next paints
+    if (gdk_window_impl_wayland_priv_get_opaque_region_dirty (window_impl)) {
+        cairo_region_t *region = gdk_window_impl_wayland_priv_get_opaque_region (window_impl);
+        struct wl_region *wl_region = wl_region_from_cairo_region (gdk_window, region);
+        wl_surface_set_opaque_region (wl_surface, wl_region);
+        if (wl_region)
+            wl_region_destroy (wl_region);
+        gdk_window_impl_wayland_priv_set_opaque_region_dirty (window_impl, FALSE);
+    }
+
+    if (gdk_window_impl_wayland_priv_get_input_region_dirty (window_impl)) {
+        cairo_region_t *region = gdk_window_impl_wayland_priv_get_input_region (window_impl);
+        struct wl_region *wl_region = wl_region_from_cairo_region (gdk_window, region);
+        wl_surface_set_input_region (wl_surface, wl_region);
+        if (wl_region)
+            wl_region_destroy (wl_region);
+        gdk_window_impl_wayland_priv_set_input_region_dirty (window_impl, FALSE);
+    }
+}
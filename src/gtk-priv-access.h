@@ -31,12 +31,21 @@ GdkSeat *gdk_window_get_priv_grab_seat (GdkWindow *gdk_window);
 // If window is not set to mapped, some subsurfaces fail (see https://github.com/wmww/gtk-layer-shell/issues/38)
 void gdk_window_set_priv_mapped (GdkWindow *gdk_window);
 
+// Sets the scale GDK renders the window's next buffer at, only if it has not rendered one since the surface was
+// created. Returns if the scale was set. Does not send wl_surface.set_buffer_scale, that's up to the caller. Queues a
+// configure event, like GDK does when it changes the scale, so GTK notices the new scale.
+gboolean gdk_window_set_priv_initial_scale (GdkWindow *gdk_window, int scale);
+
 // Gets the window geometry (area inside the window that excludes the shadow)
 GdkRectangle gtk_window_get_priv_logical_geom (GtkWindow *widget);
 
 // Checks if it is safe to commit wl_surface for the window directly
 gboolean gdk_window_get_priv_pending_commit (GdkWindow *gdk_window);
 
+// Sends the opaque and input regions set on the window if they changed since they were last sent. GDK only does this
+// when it paints, so it must be called before committing the wl_surface directly.
+void gdk_window_sync_priv_regions (GdkWindow *gdk_window);
+
 // Gets window shadow widths
 gint gdk_window_priv_get_shadow_top (GdkWindow *gdk_window);
 gint gdk_window_priv_get_shadow_bottom (GdkWindow *gdk_window);
@@ -14,13 +14,20 @@
 #include "custom-shell-surface.h"
 #include "xdg-popup-surface.h"
 #include "gtk-priv-access.h"
+#include "trace.h"
+#include "latency-probe.h"
 
 #include "xdg-shell-client.h"
 #include "wlr-layer-shell-unstable-v1-client.h"
+#include "viewporter-client.h"
+#include "fractional-scale-v1-client.h"
+#include "single-pixel-buffer-v1-client.h"
+#include "presentation-time-client.h"
 
 #include <gtk/gtk.h>
 #include <gdk/gdk.h>
 #include <gdk/gdkwayland.h>
+#include <time.h>
 
 static const char *gtk_window_key = "linked-gtk-window";
 static const char *popup_position_key = "custom-popup-position";
@@ -28,6 +35,13 @@ static const char *popup_position_key = "custom-popup-position";
 static struct wl_registry *wl_registry_global = NULL;
 static struct xdg_wm_base *xdg_wm_base_global = NULL;
 static struct zwlr_layer_shell_v1 *layer_shell_global = NULL;
+static struct wp_viewporter *viewporter_global = NULL;
+static struct wp_fractional_scale_manager_v1 *fractional_scale_manager_global = NULL;
+static struct wp_single_pixel_buffer_manager_v1 *single_pixel_buffer_manager_global = NULL;
+static struct wl_shm *shm_global = NULL;
+static GArray *shm_formats = NULL; // The wl_shm formats the compositor advertised, as uint32_ts
+static struct wp_presentation *presentation_global = NULL;
+static clockid_t presentation_clock_id = CLOCK_MONOTONIC;
 
 static gboolean has_initialized = FALSE;
 
@@ -43,6 +57,32 @@ static const struct xdg_wm_base_listener xdg_wm_base_listener = {
     .ping = xdg_wm_base_handle_ping,
 };
 
+static void
+wp_presentation_handle_clock_id (void *_data, struct wp_presentation *_presentation, uint32_t clk_id)
+{
+    (void)_data;
+    (void)_presentation;
+
+    presentation_clock_id = (clockid_t)clk_id;
+}
+
+static const struct wp_presentation_listener wp_presentation_listener = {
+    .clock_id = wp_presentation_handle_clock_id,
+};
+
+static void
+wl_shm_handle_format (void *_data, struct wl_shm *_shm, uint32_t format)
+{
+    (void)_data;
+    (void)_shm;
+
+    g_array_append_val (shm_formats, format);
+}
+
+static const struct wl_shm_listener wl_shm_listener = {
+    .format = wl_shm_handle_format,
+};
+
 gboolean
 gtk_wayland_get_has_initialized (void)
 {
@@ -61,6 +101,58 @@ gtk_wayland_get_xdg_wm_base_global ()
     return xdg_wm_base_global;
 }
 
+struct wp_viewporter *
+gtk_wayland_get_viewporter_global ()
+{
+    return viewporter_global;
+}
+
+struct wp_fractional_scale_manager_v1 *
+gtk_wayland_get_fractional_scale_manager_global ()
+{
+    return fractional_scale_manager_global;
+}
+
+struct wp_single_pixel_buffer_manager_v1 *
+gtk_wayland_get_single_pixel_buffer_manager_global ()
+{
+    return single_pixel_buffer_manager_global;
+}
+
+struct wl_shm *
+gtk_wayland_get_shm_global ()
+{
+    return shm_global;
+}
+
+gboolean
+gtk_wayland_get_shm_format_supported (uint32_t format)
+{
+    // Every compositor must support these two, even if it doesn't advertise them
+    if (format == WL_SHM_FORMAT_ARGB8888 || format == WL_SHM_FORMAT_XRGB8888)
+        return TRUE;
+
+    for (guint i = 0; shm_formats && i < shm_formats->len; i++) {
+        if (g_array_index (shm_formats, uint32_t, i) == format)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+struct wp_presentation *
+gtk_wayland_get_presentation_global ()
+{
+    return presentation_global;
+}
+
+gint64
+gtk_wayland_get_presentation_clock_time ()
+{
+    struct timespec now;
+    clock_gettime (presentation_clock_id, &now);
+    return (gint64)now.tv_sec * G_USEC_PER_SEC + now.tv_nsec / 1000;
+}
+
 static void
 wl_registry_handle_global (void *_data,
                            struct wl_registry *registry,
@@ -84,6 +176,26 @@ wl_registry_handle_global (void *_data,
                                                &xdg_wm_base_interface,
                                                MIN((uint32_t)xdg_wm_base_interface.version, version));
         xdg_wm_base_add_listener (xdg_wm_base_global, &xdg_wm_base_listener, NULL);
+    } else if (strcmp (interface, wp_viewporter_interface.name) == 0) {
+        viewporter_global = wl_registry_bind (registry, id, &wp_viewporter_interface, 1);
+    } else if (strcmp (interface, wp_fractional_scale_manager_v1_interface.name) == 0) {
+        fractional_scale_manager_global = wl_registry_bind (registry,
+                                                            id,
+                                                            &wp_fractional_scale_manager_v1_interface,
+                                                            1);
+    } else if (strcmp (interface, wp_single_pixel_buffer_manager_v1_interface.name) == 0) {
+        single_pixel_buffer_manager_global = wl_registry_bind (registry,
+                                                               id,
+                                                               &wp_single_pixel_buffer_manager_v1_interface,
+                                                               1);
+    } else if (strcmp (interface, wl_shm_interface.name) == 0) {
+        // GDK binds its own, but doesn't expose it
+        shm_global = wl_registry_bind (registry, id, &wl_shm_interface, 1);
+        shm_formats = g_array_new (FALSE, FALSE, sizeof (uint32_t));
+        wl_shm_add_listener (shm_global, &wl_shm_listener, NULL);
+    } else if (strcmp (interface, wp_presentation_interface.name) == 0) {
+        presentation_global = wl_registry_bind (registry, id, &wp_presentation_interface, 1);
+        wp_presentation_add_listener (presentation_global, &wp_presentation_listener, NULL);
     }
 }
 
@@ -167,6 +279,9 @@ gtk_wayland_init_if_needed ()
     if (has_initialized)
         return;
 
+    trace_init ();
+    latency_probe_init ();
+
     GdkDisplay *gdk_display = gdk_display_get_default ();
     g_return_if_fail (gdk_display);
     g_return_if_fail (GDK_IS_WAYLAND_DISPLAY (gdk_display));
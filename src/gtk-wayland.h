@@ -20,6 +20,14 @@
 gboolean gtk_wayland_get_has_initialized (void);
 struct xdg_wm_base *gtk_wayland_get_xdg_wm_base_global (void);
 struct zwlr_layer_shell_v1 *gtk_wayland_get_layer_shell_global (void);
+struct wp_viewporter *gtk_wayland_get_viewporter_global (void); // Can be NULL
+struct wp_fractional_scale_manager_v1 *gtk_wayland_get_fractional_scale_manager_global (void); // Can be NULL
+struct wp_single_pixel_buffer_manager_v1 *gtk_wayland_get_single_pixel_buffer_manager_global (void); // Can be NULL
+struct wl_shm *gtk_wayland_get_shm_global (void); // Can be NULL
+gboolean gtk_wayland_get_shm_format_supported (uint32_t format);
+struct wp_presentation *gtk_wayland_get_presentation_global (void); // Can be NULL
+// Current time in microseconds, in the clock the compositor uses for presentation timestamps
+gint64 gtk_wayland_get_presentation_clock_time (void);
 
 void gtk_wayland_init_if_needed (void);
 
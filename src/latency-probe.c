@@ -0,0 +1,122 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "latency-probe.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Number of samples kept for each kind and stage, older samples are overwritten
+#define LATENCY_PROBE_SAMPLES 256
+
+typedef struct {
+    gint64 samples[LATENCY_PROBE_SAMPLES];
+    guint total; // Samples ever added, the next one goes at total % LATENCY_PROBE_SAMPLES
+} LatencyProbeSamples;
+
+static const char *latency_probe_kind_names[GTK_LAYER_SHELL_LATENCY_KIND_ENTRY_NUMBER] = {
+    [GTK_LAYER_SHELL_LATENCY_KIND_LAYER] = "layer",
+    [GTK_LAYER_SHELL_LATENCY_KIND_ANCHOR] = "anchor",
+    [GTK_LAYER_SHELL_LATENCY_KIND_MARGIN] = "margin",
+    [GTK_LAYER_SHELL_LATENCY_KIND_EXCLUSIVE_ZONE] = "exclusive-zone",
+    [GTK_LAYER_SHELL_LATENCY_KIND_KEYBOARD_MODE] = "keyboard-mode",
+};
+
+static gboolean latency_probe_initialized = FALSE;
+// Indexed by kind * GTK_LAYER_SHELL_LATENCY_STAGE_ENTRY_NUMBER + stage, NULL when the probe is disabled
+static LatencyProbeSamples *latency_probe_samples = NULL;
+
+void
+latency_probe_init (void)
+{
+    if (latency_probe_initialized)
+        return;
+    latency_probe_initialized = TRUE;
+
+    const char *env = g_getenv ("GTK_LAYER_SHELL_LATENCY_PROBE");
+    if (!env || !*env || g_strcmp0 (env, "0") == 0)
+        return;
+
+    latency_probe_samples = g_new0 (LatencyProbeSamples,
+                                    GTK_LAYER_SHELL_LATENCY_KIND_ENTRY_NUMBER *
+                                    GTK_LAYER_SHELL_LATENCY_STAGE_ENTRY_NUMBER);
+}
+
+static LatencyProbeSamples *
+latency_probe_get_samples (GtkLayerShellLatencyKind kind, GtkLayerShellLatencyStage stage)
+{
+    return &latency_probe_samples[kind * GTK_LAYER_SHELL_LATENCY_STAGE_ENTRY_NUMBER + stage];
+}
+
+gboolean
+latency_probe_get_enabled (void)
+{
+    return latency_probe_samples != NULL;
+}
+
+void
+latency_probe_add_sample (GtkLayerShellLatencyKind kind, GtkLayerShellLatencyStage stage, gint64 latency)
+{
+    if (!latency_probe_samples)
+        return;
+    g_return_if_fail (kind >= 0 && kind < GTK_LAYER_SHELL_LATENCY_KIND_ENTRY_NUMBER);
+    g_return_if_fail (stage >= 0 && stage < GTK_LAYER_SHELL_LATENCY_STAGE_ENTRY_NUMBER);
+
+    LatencyProbeSamples *samples = latency_probe_get_samples (kind, stage);
+    samples->samples[samples->total % LATENCY_PROBE_SAMPLES] = latency;
+    samples->total++;
+}
+
+guint
+latency_probe_get_sample_count (GtkLayerShellLatencyKind kind, GtkLayerShellLatencyStage stage)
+{
+    if (!latency_probe_samples)
+        return 0;
+    g_return_val_if_fail (kind >= 0 && kind < GTK_LAYER_SHELL_LATENCY_KIND_ENTRY_NUMBER, 0);
+    g_return_val_if_fail (stage >= 0 && stage < GTK_LAYER_SHELL_LATENCY_STAGE_ENTRY_NUMBER, 0);
+
+    return MIN (latency_probe_get_samples (kind, stage)->total, LATENCY_PROBE_SAMPLES);
+}
+
+static int
+compare_gint64 (const void *a, const void *b)
+{
+    gint64 lhs = *(const gint64 *)a;
+    gint64 rhs = *(const gint64 *)b;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+gint64
+latency_probe_get_percentile (GtkLayerShellLatencyKind kind, GtkLayerShellLatencyStage stage, double percentile)
+{
+    guint count = latency_probe_get_sample_count (kind, stage);
+    if (count == 0)
+        return -1;
+
+    gint64 sorted[LATENCY_PROBE_SAMPLES];
+    memcpy (sorted, latency_probe_get_samples (kind, stage)->samples, count * sizeof (gint64));
+    qsort (sorted, count, sizeof (gint64), compare_gint64);
+
+    // Nearest-rank percentile, the rank is percentile% of count rounded up
+    double exact_rank = CLAMP (percentile, 0.0, 100.0) / 100.0 * count;
+    guint rank = (guint)exact_rank;
+    if (rank < exact_rank)
+        rank++;
+    return sorted[CLAMP (rank, 1u, count) - 1];
+}
+
+const char *
+latency_probe_kind_get_name (GtkLayerShellLatencyKind kind)
+{
+    g_return_val_if_fail (kind >= 0 && kind < GTK_LAYER_SHELL_LATENCY_KIND_ENTRY_NUMBER, NULL);
+    return latency_probe_kind_names[kind];
+}
@@ -0,0 +1,39 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef LATENCY_PROBE_H
+#define LATENCY_PROBE_H
+
+#include "gtk-layer-shell.h"
+
+#include <glib.h>
+
+// Collects how long state changes take to reach each stage, enabled by setting GTK_LAYER_SHELL_LATENCY_PROBE=1. Which
+// changes are at which stage is tracked per surface in custom-shell-surface.c, this just stores the results.
+
+// Reads the environment, safe to call multiple times
+void latency_probe_init (void);
+
+gboolean latency_probe_get_enabled (void);
+
+// Does nothing if the probe is disabled
+void latency_probe_add_sample (GtkLayerShellLatencyKind kind, GtkLayerShellLatencyStage stage, gint64 latency);
+
+// Returns -1 if there are no samples
+gint64 latency_probe_get_percentile (GtkLayerShellLatencyKind kind, GtkLayerShellLatencyStage stage, double percentile);
+
+guint latency_probe_get_sample_count (GtkLayerShellLatencyKind kind, GtkLayerShellLatencyStage stage);
+
+// Returns a static string used to identify the kind in traces
+const char *latency_probe_kind_get_name (GtkLayerShellLatencyKind kind);
+
+#endif // LATENCY_PROBE_H
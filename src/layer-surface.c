@@ -15,13 +15,58 @@
 #include "simple-conversions.h"
 #include "custom-shell-surface.h"
 #include "gtk-wayland.h"
+#include "gtk-priv-access.h"
+#include "trace.h"
 
 #include "wlr-layer-shell-unstable-v1-client.h"
 #include "xdg-shell-client.h"
+#include "viewporter-client.h"
+#include "fractional-scale-v1-client.h"
 
 #include <gtk/gtk.h>
 #include <gdk/gdkwayland.h>
 
+// Property names used when tracing state changes, indexed by GtkLayerShellEdge
+static const char *anchor_trace_names[GTK_LAYER_SHELL_EDGE_ENTRY_NUMBER] = {
+    [GTK_LAYER_SHELL_EDGE_LEFT] = "anchor-left",
+    [GTK_LAYER_SHELL_EDGE_RIGHT] = "anchor-right",
+    [GTK_LAYER_SHELL_EDGE_TOP] = "anchor-top",
+    [GTK_LAYER_SHELL_EDGE_BOTTOM] = "anchor-bottom",
+};
+
+static const char *margin_trace_names[GTK_LAYER_SHELL_EDGE_ENTRY_NUMBER] = {
+    [GTK_LAYER_SHELL_EDGE_LEFT] = "margin-left",
+    [GTK_LAYER_SHELL_EDGE_RIGHT] = "margin-right",
+    [GTK_LAYER_SHELL_EDGE_TOP] = "margin-top",
+    [GTK_LAYER_SHELL_EDGE_BOTTOM] = "margin-bottom",
+};
+
+static void
+layer_surface_send_set_size_request (LayerSurface *self)
+{
+    trace_event ((CustomShellSurface *)self, TRACE_EVENT_REQUEST, "zwlr_layer_surface_v1.set_size", 2,
+                 self->cached_layer_size.width, self->cached_layer_size.height, 0, 0);
+    zwlr_layer_surface_v1_set_size (self->layer_surface,
+                                    self->cached_layer_size.width,
+                                    self->cached_layer_size.height);
+}
+
+static void
+layer_surface_send_set_exclusive_zone (LayerSurface *self)
+{
+    trace_event ((CustomShellSurface *)self, TRACE_EVENT_REQUEST, "zwlr_layer_surface_v1.set_exclusive_zone", 1,
+                 self->exclusive_zone, 0, 0, 0);
+    zwlr_layer_surface_v1_set_exclusive_zone (self->layer_surface, self->exclusive_zone);
+}
+
+static void
+layer_surface_send_set_keyboard_interactivity (LayerSurface *self)
+{
+    trace_event ((CustomShellSurface *)self, TRACE_EVENT_REQUEST,
+                 "zwlr_layer_surface_v1.set_keyboard_interactivity", 1, self->keyboard_mode, 0, 0, 0);
+    zwlr_layer_surface_v1_set_keyboard_interactivity (self->layer_surface, self->keyboard_mode);
+}
+
 /*
  * Sends the .set_size request if the current allocation differs from the last size sent
  * Needs to be called whenever current_allocation or anchors are changed
@@ -49,13 +94,182 @@ layer_surface_send_set_size (LayerSurface *self)
 
         self->cached_layer_size = request_size;
         if (self->layer_surface) {
-            zwlr_layer_surface_v1_set_size (self->layer_surface,
-                                            self->cached_layer_size.width,
-                                            self->cached_layer_size.height);
+            layer_surface_send_set_size_request (self);
         }
     }
 }
 
+/*
+ * Returns the size the surface will have once GTK catches up with the last configure
+ * Along stretched axes that's the configured size, which GTK may not have allocated yet. Margins are outside of the
+ * surface, so they don't affect the size.
+ */
+static GtkRequisition
+layer_surface_get_logical_size (LayerSurface *self)
+{
+    GtkRequisition size = self->current_allocation;
+    if (self->anchors[GTK_LAYER_SHELL_EDGE_LEFT] &&
+        self->anchors[GTK_LAYER_SHELL_EDGE_RIGHT] &&
+        self->last_configure_size.width > 0) {
+
+        size.width = self->last_configure_size.width;
+    }
+    if (self->anchors[GTK_LAYER_SHELL_EDGE_TOP] &&
+        self->anchors[GTK_LAYER_SHELL_EDGE_BOTTOM] &&
+        self->last_configure_size.height > 0) {
+
+        size.height = self->last_configure_size.height;
+    }
+    return size;
+}
+
+// If the surface shows a buffer of ours (a solid color or a client buffer) instead of what GTK draws
+static gboolean
+layer_surface_has_own_content (LayerSurface *self)
+{
+    return self->client_buffer || self->solid_color;
+}
+
+/*
+ * Sets the logical size of the surface through the viewport, so the compositor doesn't have to derive it from the
+ * buffer size and scale
+ * Needs to be called whenever current_allocation changes, and when the viewport is created. When the surface has its
+ * own content it also needs to be called on configure.
+ */
+static void
+layer_surface_send_set_viewport_destination (LayerSurface *self)
+{
+    if (!self->viewport)
+        return;
+
+    // GDK's buffers have the allocated size, and GDK doesn't commit between a configure and the allocation that
+    // follows it. Our own buffers can be stretched to any size, so they follow configures immediately.
+    GtkRequisition size = layer_surface_has_own_content (self) ?
+        layer_surface_get_logical_size (self) :
+        self->current_allocation;
+    gint width = size.width;
+    gint height = size.height;
+    if (width <= 0 || height <= 0)
+        width = height = -1; // A destination has to be positive, -1 unsets it
+
+    trace_event ((CustomShellSurface *)self, TRACE_EVENT_REQUEST, "wp_viewport.set_destination", 2,
+                 width, height, 0, 0);
+    wp_viewport_set_destination (self->viewport, width, height);
+}
+
+// Converts a color channel (0 to 1) to the range single pixel buffers use
+static uint32_t
+color_channel_to_u32 (double value)
+{
+    return (uint32_t)(CLAMP (value, 0.0, 1.0) * (double)UINT32_MAX);
+}
+
+struct _LayerSurfaceBuffer
+{
+    LayerSurface *layer_surface;
+    struct wl_buffer *wl_buffer;
+    GtkLayerBufferReleaseFunc release_func; // Can be NULL
+    gpointer user_data;
+    gboolean busy; // If it has been attached since the compositor last released it
+};
+
+static void
+layer_surface_buffer_free (LayerSurfaceBuffer *buffer)
+{
+    wl_buffer_destroy (buffer->wl_buffer);
+    if (buffer->release_func)
+        buffer->release_func (buffer->user_data);
+    g_free (buffer);
+}
+
+static void
+layer_surface_buffer_handle_release (void *data, struct wl_buffer *_wl_buffer)
+{
+    LayerSurfaceBuffer *buffer = data;
+    LayerSurface *self = buffer->layer_surface;
+    (void)_wl_buffer;
+
+    buffer->busy = FALSE;
+    // The current buffer is kept, as it may need to be attached again after a configure
+    if (buffer != self->client_buffer) {
+        self->retired_buffers = g_list_remove (self->retired_buffers, buffer);
+        layer_surface_buffer_free (buffer);
+    }
+}
+
+static const struct wl_buffer_listener layer_surface_buffer_listener = {
+    .release = layer_surface_buffer_handle_release,
+};
+
+// Stops using client_buffer, which is freed as soon as the compositor is done with it
+static void
+layer_surface_retire_client_buffer (LayerSurface *self)
+{
+    LayerSurfaceBuffer *buffer = self->client_buffer;
+    if (!buffer)
+        return;
+
+    self->client_buffer = NULL;
+    if (buffer->busy)
+        self->retired_buffers = g_list_prepend (self->retired_buffers, buffer);
+    else
+        layer_surface_buffer_free (buffer);
+}
+
+/*
+ * Attaches client_buffer, or else a single pixel buffer of solid_color. Either is stretched over the whole surface by
+ * the viewport. Does nothing if the surface has no content of its own.
+ * Needs to be called after each configure when the surface has its own content, as the first one needs a buffer and
+ * later ones may come with a new surface. Does not commit.
+ */
+static void
+layer_surface_attach_content (LayerSurface *self)
+{
+    GtkWindow *gtk_window = custom_shell_surface_get_gtk_window ((CustomShellSurface *)self);
+    GdkWindow *gdk_window = gtk_widget_get_window (GTK_WIDGET (gtk_window));
+    struct wl_surface *wl_surface = gdk_window ? gdk_wayland_window_get_wl_surface (gdk_window) : NULL;
+    if (!layer_surface_has_own_content (self) || !self->viewport || !wl_surface)
+        return;
+
+    struct wl_buffer *wl_buffer;
+    if (self->client_buffer) {
+        self->client_buffer->busy = TRUE;
+        wl_buffer = self->client_buffer->wl_buffer;
+    } else {
+        if (!self->solid_color_buffer) {
+            // Channels are premultiplied by alpha
+            const GdkRGBA *color = self->solid_color;
+            double alpha = CLAMP (color->alpha, 0.0, 1.0);
+            self->solid_color_buffer = wp_single_pixel_buffer_manager_v1_create_u32_rgba_buffer (
+                gtk_wayland_get_single_pixel_buffer_manager_global (),
+                color_channel_to_u32 (color->red * alpha),
+                color_channel_to_u32 (color->green * alpha),
+                color_channel_to_u32 (color->blue * alpha),
+                color_channel_to_u32 (alpha));
+        }
+        wl_buffer = self->solid_color_buffer;
+    }
+
+    trace_event ((CustomShellSurface *)self, TRACE_EVENT_REQUEST, "wl_surface.attach", 0, 0, 0, 0, 0);
+    wl_surface_attach (wl_surface, wl_buffer, 0, 0);
+    wl_surface_damage (wl_surface, 0, 0, INT32_MAX, INT32_MAX);
+}
+
+// Needs to be called whenever solid_color or client_buffer changes
+static void
+layer_surface_update_content (LayerSurface *self)
+{
+    custom_shell_surface_set_updates_frozen ((CustomShellSurface *)self, layer_surface_has_own_content (self));
+
+    if (self->layer_surface && !self->super.awaiting_initial_configure) {
+        // Without content of our own nothing is attached here, GDK attaches its own buffer on the repaint that
+        // thawing triggers
+        layer_surface_send_set_viewport_destination (self);
+        layer_surface_attach_content (self);
+        custom_shell_surface_needs_commit ((CustomShellSurface *)self);
+    }
+}
+
 /*
  * Sets the window's geometry hints (used to force the window to be a specific size)
  * Needs to be called whenever last_configure_size or anchors are changed
@@ -100,6 +314,61 @@ layer_surface_update_size (LayerSurface *self)
     layer_surface_send_set_size (self);
 }
 
+/*
+ * Overrides the GdkWindow's opaque region with ours, which is sent along with the next commit (by GDK when it paints,
+ * or by custom_shell_surface_force_commit () while updates are frozen)
+ * Needs to be called whenever the size changes and after anything that lets GTK set its own region (allocation, style
+ * updates, mapping). GDK ignores regions equal to the current one, so calling this too often is cheap.
+ * Does nothing if neither an explicit nor an automatic region is set, in which case GTK stays in charge
+ */
+static void
+layer_surface_update_opaque_region (LayerSurface *self)
+{
+    if (!self->auto_opaque_region && !self->opaque_region)
+        return;
+
+    GtkWindow *gtk_window = custom_shell_surface_get_gtk_window ((CustomShellSurface *)self);
+    GdkWindow *gdk_window = gtk_widget_get_window (GTK_WIDGET (gtk_window));
+    if (!gdk_window)
+        return;
+
+    if (self->auto_opaque_region) {
+        GtkRequisition size = layer_surface_get_logical_size (self);
+        cairo_rectangle_int_t rect = {
+            .x = 0,
+            .y = 0,
+            .width = size.width,
+            .height = size.height,
+        };
+        cairo_region_t *region = cairo_region_create_rectangle (&rect);
+        gdk_window_set_opaque_region (gdk_window, region);
+        cairo_region_destroy (region);
+    } else {
+        gdk_window_set_opaque_region (gdk_window, self->opaque_region);
+    }
+}
+
+/*
+ * Sets the GdkWindow's input shape, which is sent along with the next commit like the opaque region
+ * Needs to be called whenever click_through or input_region change, and on map since that gives GDK a new wl_surface
+ */
+static void
+layer_surface_send_input_region (LayerSurface *self)
+{
+    GtkWindow *gtk_window = custom_shell_surface_get_gtk_window ((CustomShellSurface *)self);
+    GdkWindow *gdk_window = gtk_widget_get_window (GTK_WIDGET (gtk_window));
+    if (!gdk_window)
+        return;
+
+    if (self->click_through) {
+        cairo_region_t *empty = cairo_region_create ();
+        gdk_window_input_shape_combine_region (gdk_window, empty, 0, 0);
+        cairo_region_destroy (empty);
+    } else {
+        gdk_window_input_shape_combine_region (gdk_window, self->input_region, 0, 0);
+    }
+}
+
 static void
 layer_surface_handle_configure (void *data,
                                 struct zwlr_layer_surface_v1 *surface,
@@ -109,8 +378,10 @@ layer_surface_handle_configure (void *data,
 {
     LayerSurface *self = data;
 
+    trace_event ((CustomShellSurface *)self, TRACE_EVENT_CONFIGURE, "zwlr_layer_surface_v1.configure", 3,
+                 serial, w, h, 0);
     zwlr_layer_surface_v1_ack_configure (surface, serial);
-    self->super.awaiting_initial_configure = FALSE;
+    custom_shell_surface_handle_configure ((CustomShellSurface *)self, serial);
 
     self->last_configure_size = (GtkRequisition) {
         .width = (gint)w,
@@ -118,6 +389,14 @@ layer_surface_handle_configure (void *data,
     };
 
     layer_surface_update_size (self);
+    layer_surface_update_opaque_region (self);
+
+    if (layer_surface_has_own_content (self)) {
+        // GDK isn't painting, so it's up to us to commit a buffer of the new size
+        layer_surface_send_set_viewport_destination (self);
+        layer_surface_attach_content (self);
+        custom_shell_surface_needs_commit ((CustomShellSurface *)self);
+    }
 }
 
 static void
@@ -145,11 +424,58 @@ static const struct zwlr_layer_surface_v1_listener layer_surface_listener = {
     .closed = layer_surface_handle_closed,
 };
 
+/*
+ * GDK starts every surface at the scale of the first monitor, and only learns the right one when the compositor sends
+ * wl_surface.enter, which is usually after the first buffer has been rendered. This makes GDK render the first buffer
+ * at the given scale instead, so it doesn't have to be rendered twice.
+ * Does nothing once GDK has rendered a buffer for the current wl_surface, from then on GDK follows the outputs itself
+ */
+static void
+layer_surface_set_initial_scale (LayerSurface *self, int scale)
+{
+    GtkWindow *gtk_window = custom_shell_surface_get_gtk_window ((CustomShellSurface *)self);
+    GdkWindow *gdk_window = gtk_widget_get_window (GTK_WIDGET (gtk_window));
+    if (scale < 1 || !gdk_window || gdk_window_get_scale_factor (gdk_window) == scale)
+        return;
+
+    struct wl_surface *wl_surface = gdk_wayland_window_get_wl_surface (gdk_window);
+    if (!wl_surface || wl_surface_get_version (wl_surface) < WL_SURFACE_SET_BUFFER_SCALE_SINCE_VERSION)
+        return;
+
+    if (gdk_window_set_priv_initial_scale (gdk_window, scale)) {
+        trace_event ((CustomShellSurface *)self, TRACE_EVENT_REQUEST, "wl_surface.set_buffer_scale", 1,
+                     scale, 0, 0, 0);
+        wl_surface_set_buffer_scale (wl_surface, scale);
+    }
+}
+
+static void
+layer_surface_handle_preferred_scale (void *data,
+                                      struct wp_fractional_scale_v1 *_fractional_scale,
+                                      uint32_t scale)
+{
+    LayerSurface *self = data;
+    (void)_fractional_scale;
+
+    trace_event ((CustomShellSurface *)self, TRACE_EVENT_CONFIGURE, "wp_fractional_scale_v1.preferred_scale", 1,
+                 scale, 0, 0, 0);
+    self->preferred_scale = scale;
+    // Usually arrives along with the initial configure, so the first buffer can still use it. GTK 3 can only render
+    // at integer scales, so round up and let the compositor scale down.
+    layer_surface_set_initial_scale (self, (scale + 119) / 120);
+}
+
+static const struct wp_fractional_scale_v1_listener fractional_scale_listener = {
+    .preferred_scale = layer_surface_handle_preferred_scale,
+};
+
 static void
 layer_surface_send_set_anchor (LayerSurface *self)
 {
     if (self->layer_surface) {
         uint32_t wlr_anchor = gtk_layer_shell_edge_array_get_zwlr_layer_shell_v1_anchor (self->anchors);
+        trace_event ((CustomShellSurface *)self, TRACE_EVENT_REQUEST, "zwlr_layer_surface_v1.set_anchor", 1,
+                     wlr_anchor, 0, 0, 0);
         zwlr_layer_surface_v1_set_anchor (self->layer_surface, wlr_anchor);
     }
 }
@@ -158,6 +484,11 @@ static void
 layer_surface_send_set_margin (LayerSurface *self)
 {
     if (self->layer_surface) {
+        trace_event ((CustomShellSurface *)self, TRACE_EVENT_REQUEST, "zwlr_layer_surface_v1.set_margin", 4,
+                     self->margins[GTK_LAYER_SHELL_EDGE_TOP],
+                     self->margins[GTK_LAYER_SHELL_EDGE_RIGHT],
+                     self->margins[GTK_LAYER_SHELL_EDGE_BOTTOM],
+                     self->margins[GTK_LAYER_SHELL_EDGE_LEFT]);
         zwlr_layer_surface_v1_set_margin (self->layer_surface,
                                           self->margins[GTK_LAYER_SHELL_EDGE_TOP],
                                           self->margins[GTK_LAYER_SHELL_EDGE_RIGHT],
@@ -184,6 +515,7 @@ layer_surface_map (CustomShellSurface *super, struct wl_surface *wl_surface)
     }
 
     enum zwlr_layer_shell_v1_layer layer = gtk_layer_shell_layer_get_zwlr_layer_shell_v1_layer(self->layer);
+    trace_event (super, TRACE_EVENT_REQUEST, "zwlr_layer_shell_v1.get_layer_surface", 1, layer, 0, 0, 0);
     self->layer_surface = zwlr_layer_shell_v1_get_layer_surface (layer_shell_global,
                                                                  wl_surface,
                                                                  output,
@@ -191,18 +523,44 @@ layer_surface_map (CustomShellSurface *super, struct wl_surface *wl_surface)
                                                                  name_space);
     g_return_if_fail (self->layer_surface);
 
-    zwlr_layer_surface_v1_set_keyboard_interactivity (self->layer_surface, self->keyboard_mode);
-    zwlr_layer_surface_v1_set_exclusive_zone (self->layer_surface, self->exclusive_zone);
+    layer_surface_send_set_keyboard_interactivity (self);
+    layer_surface_send_set_exclusive_zone (self);
     layer_surface_send_set_anchor (self);
     layer_surface_send_set_margin (self);
     if (self->cached_layer_size.width >= 0 && self->cached_layer_size.height >= 0) {
-        zwlr_layer_surface_v1_set_size (self->layer_surface,
-                                        self->cached_layer_size.width,
-                                        self->cached_layer_size.height);
+        layer_surface_send_set_size_request (self);
     }
     zwlr_layer_surface_v1_add_listener (self->layer_surface, &layer_surface_listener, self);
+
+    // The compositor only tells us which output the surface is on after the initial commit, so guess the scale now.
+    // If no monitor is set the compositor picks one, and the one it picked last time is the best guess.
+    if (self->monitor) {
+        layer_surface_set_initial_scale (self, gdk_monitor_get_scale_factor (self->monitor));
+    } else if (self->preferred_scale > 0) {
+        layer_surface_set_initial_scale (self, (self->preferred_scale + 119) / 120);
+    }
+
+    struct wp_fractional_scale_manager_v1 *scale_manager = gtk_wayland_get_fractional_scale_manager_global ();
+    if (scale_manager) {
+        trace_event (super, TRACE_EVENT_REQUEST, "wp_fractional_scale_manager_v1.get_fractional_scale", 0, 0, 0, 0, 0);
+        self->fractional_scale = wp_fractional_scale_manager_v1_get_fractional_scale (scale_manager, wl_surface);
+        wp_fractional_scale_v1_add_listener (self->fractional_scale, &fractional_scale_listener, self);
+    }
+
+    struct wp_viewporter *viewporter = gtk_wayland_get_viewporter_global ();
+    if (viewporter) {
+        trace_event (super, TRACE_EVENT_REQUEST, "wp_viewporter.get_viewport", 0, 0, 0, 0, 0);
+        self->viewport = wp_viewporter_get_viewport (viewporter, wl_surface);
+        layer_surface_send_set_viewport_destination (self);
+    }
+
     self->super.awaiting_initial_configure = TRUE;
     self->remap_on_monitor_change = FALSE;
+    layer_surface_update_opaque_region (self);
+    // Leave the input shape alone if it was never changed, in case the app set one through GTK
+    if (self->click_through || self->input_region) {
+        layer_surface_send_input_region (self);
+    }
 }
 
 static void
@@ -210,7 +568,18 @@ layer_surface_unmap (CustomShellSurface *super)
 {
     LayerSurface *self = (LayerSurface *)super;
 
+    // Both have to be destroyed before the wl_surface, which GDK does right after this
+    if (self->viewport) {
+        wp_viewport_destroy (self->viewport);
+        self->viewport = NULL;
+    }
+    if (self->fractional_scale) {
+        wp_fractional_scale_v1_destroy (self->fractional_scale);
+        self->fractional_scale = NULL;
+    }
+
     if (self->layer_surface) {
+        trace_event (super, TRACE_EVENT_REQUEST, "zwlr_layer_surface_v1.destroy", 0, 0, 0, 0, 0);
         zwlr_layer_surface_v1_destroy (self->layer_surface);
         self->layer_surface = NULL;
     }
@@ -226,6 +595,14 @@ layer_surface_finalize (CustomShellSurface *super)
     // Disconnect the monitor change signals
     g_signal_handlers_disconnect_by_data (gdk_display, self);
     g_clear_object (&self->monitor);
+    g_clear_pointer (&self->opaque_region, cairo_region_destroy);
+    g_clear_pointer (&self->input_region, cairo_region_destroy);
+    g_clear_pointer (&self->solid_color, gdk_rgba_free);
+    g_clear_pointer (&self->solid_color_buffer, wl_buffer_destroy);
+    // The surface is gone, so there is no point waiting for the compositor to release buffers
+    g_clear_pointer (&self->client_buffer, layer_surface_buffer_free);
+    g_list_free_full (self->retired_buffers, (GDestroyNotify)layer_surface_buffer_free);
+    self->retired_buffers = NULL;
 }
 
 static struct xdg_popup *
@@ -241,6 +618,7 @@ layer_surface_get_popup (CustomShellSurface *super,
     }
 
     struct xdg_popup *xdg_popup = xdg_surface_get_popup (popup_xdg_surface, NULL, positioner);
+    trace_event (super, TRACE_EVENT_REQUEST, "zwlr_layer_surface_v1.get_popup", 0, 0, 0, 0, 0);
     zwlr_layer_surface_v1_get_popup (self->layer_surface, xdg_popup);
     return xdg_popup;
 }
@@ -288,8 +666,12 @@ layer_surface_update_auto_exclusive_zone (LayerSurface *self)
 
     if (new_exclusive_zone >= 0 && self->exclusive_zone != new_exclusive_zone) {
         self->exclusive_zone = new_exclusive_zone;
+        trace_event ((CustomShellSurface *)self, TRACE_EVENT_STATE_CHANGE, "exclusive-zone", 1,
+                     self->exclusive_zone, 0, 0, 0);
         if (self->layer_surface) {
-            zwlr_layer_surface_v1_set_exclusive_zone (self->layer_surface, self->exclusive_zone);
+            layer_surface_send_set_exclusive_zone (self);
+            custom_shell_surface_latency_mark_change ((CustomShellSurface *)self,
+                                                      GTK_LAYER_SHELL_LATENCY_KIND_EXCLUSIVE_ZONE);
         }
     }
 }
@@ -310,8 +692,27 @@ layer_surface_on_size_allocate (GtkWidget *_gtk_window,
         };
 
         layer_surface_send_set_size (self);
+        layer_surface_send_set_viewport_destination (self);
         layer_surface_update_auto_exclusive_zone (self);
+        if (layer_surface_has_own_content (self)) {
+            custom_shell_surface_needs_commit ((CustomShellSurface *)self);
+        }
+        // Resizes from a configure end up here too. Whatever holds GDK back, it has to render once more at the new size
+        // so the new viewport destination isn't committed with a buffer of the old size.
+        custom_shell_surface_size_changed ((CustomShellSurface *)self);
     }
+
+    // GTK recalculates its own opaque region on every allocation, so ours has to be applied again even if the size
+    // didn't change. This handler runs after GTK's, since size-allocate is a run-first signal.
+    layer_surface_update_opaque_region (self);
+}
+
+static void
+layer_surface_on_style_updated (GtkWidget *_gtk_window, LayerSurface *self)
+{
+    (void)_gtk_window;
+    // A style change can also make GTK replace the opaque region
+    layer_surface_update_opaque_region (self);
 }
 
 static void monitor_changed(GdkDisplay* self, GdkMonitor* monitor, LayerSurface *layer_surface) {
@@ -348,10 +749,22 @@ layer_surface_new (GtkWindow *gtk_window)
     self->exclusive_zone = 0;
     self->auto_exclusive_zone = FALSE;
     self->keyboard_mode = GTK_LAYER_SHELL_KEYBOARD_MODE_NONE;
+    self->auto_opaque_region = FALSE;
+    self->opaque_region = NULL;
+    self->click_through = FALSE;
+    self->input_region = NULL;
     self->layer_surface = NULL;
+    self->viewport = NULL;
+    self->fractional_scale = NULL;
+    self->preferred_scale = 0;
+    self->solid_color = NULL;
+    self->solid_color_buffer = NULL;
+    self->client_buffer = NULL;
+    self->retired_buffers = NULL;
 
     gtk_window_set_decorated (gtk_window, FALSE);
     g_signal_connect (gtk_window, "size-allocate", G_CALLBACK (layer_surface_on_size_allocate), self);
+    g_signal_connect (gtk_window, "style-updated", G_CALLBACK (layer_surface_on_style_updated), self);
     GdkDisplay *gdk_display = gdk_display_get_default ();
     g_signal_connect (gdk_display, "monitor-added", G_CALLBACK (monitor_changed), self);
     g_signal_connect (gdk_display, "monitor-removed", G_CALLBACK (monitor_changed), self);
@@ -377,6 +790,7 @@ layer_surface_set_monitor (LayerSurface *self, GdkMonitor *monitor)
         if (monitor) {
             self->monitor = g_object_ref (monitor);
         }
+        trace_event ((CustomShellSurface *)self, TRACE_EVENT_STATE_CHANGE, "monitor", 0, 0, 0, 0, 0);
         if (self->layer_surface) {
             custom_shell_surface_remap ((CustomShellSurface *)self);
         }
@@ -389,6 +803,7 @@ layer_surface_set_name_space (LayerSurface *self, char const* name_space)
     if (g_strcmp0(self->name_space, name_space) != 0) {
         g_free ((gpointer)self->name_space);
         self->name_space = g_strdup (name_space);
+        trace_event ((CustomShellSurface *)self, TRACE_EVENT_STATE_CHANGE, "namespace", 0, 0, 0, 0, 0);
         if (self->layer_surface) {
             custom_shell_surface_remap ((CustomShellSurface *)self);
         }
@@ -400,11 +815,16 @@ layer_surface_set_layer (LayerSurface *self, GtkLayerShellLayer layer)
 {
     if (self->layer != layer) {
         self->layer = layer;
+        trace_event ((CustomShellSurface *)self, TRACE_EVENT_STATE_CHANGE, "layer", 1, layer, 0, 0, 0);
         if (self->layer_surface) {
             uint32_t version = zwlr_layer_surface_v1_get_version (self->layer_surface);
             if (version >= ZWLR_LAYER_SURFACE_V1_SET_LAYER_SINCE_VERSION) {
                 enum zwlr_layer_shell_v1_layer wlr_layer = gtk_layer_shell_layer_get_zwlr_layer_shell_v1_layer(layer);
+                trace_event ((CustomShellSurface *)self, TRACE_EVENT_REQUEST, "zwlr_layer_surface_v1.set_layer", 1,
+                             wlr_layer, 0, 0, 0);
                 zwlr_layer_surface_v1_set_layer (self->layer_surface, wlr_layer);
+                custom_shell_surface_latency_mark_change ((CustomShellSurface *)self,
+                                                          GTK_LAYER_SHELL_LATENCY_KIND_LAYER);
                 custom_shell_surface_needs_commit ((CustomShellSurface *)self);
             } else {
                 custom_shell_surface_remap ((CustomShellSurface *)self);
@@ -420,8 +840,11 @@ layer_surface_set_anchor (LayerSurface *self, GtkLayerShellEdge edge, gboolean a
     anchor_to_edge = (anchor_to_edge != FALSE);
     if (anchor_to_edge != self->anchors[edge]) {
         self->anchors[edge] = anchor_to_edge;
+        trace_event ((CustomShellSurface *)self, TRACE_EVENT_STATE_CHANGE, anchor_trace_names[edge], 1,
+                     anchor_to_edge, 0, 0, 0);
         if (self->layer_surface) {
             layer_surface_send_set_anchor (self);
+            custom_shell_surface_latency_mark_change ((CustomShellSurface *)self, GTK_LAYER_SHELL_LATENCY_KIND_ANCHOR);
             layer_surface_update_size (self);
             layer_surface_update_auto_exclusive_zone (self);
             custom_shell_surface_needs_commit ((CustomShellSurface *)self);
@@ -435,7 +858,12 @@ layer_surface_set_margin (LayerSurface *self, GtkLayerShellEdge edge, int margin
     g_return_if_fail (edge >= 0 && edge < GTK_LAYER_SHELL_EDGE_ENTRY_NUMBER);
     if (margin_size != self->margins[edge]) {
         self->margins[edge] = margin_size;
+        trace_event ((CustomShellSurface *)self, TRACE_EVENT_STATE_CHANGE, margin_trace_names[edge], 1,
+                     margin_size, 0, 0, 0);
         layer_surface_send_set_margin (self);
+        if (self->layer_surface) {
+            custom_shell_surface_latency_mark_change ((CustomShellSurface *)self, GTK_LAYER_SHELL_LATENCY_KIND_MARGIN);
+        }
         layer_surface_update_auto_exclusive_zone (self);
         custom_shell_surface_needs_commit ((CustomShellSurface *)self);
     }
@@ -449,8 +877,12 @@ layer_surface_set_exclusive_zone (LayerSurface *self, int exclusive_zone)
         exclusive_zone = -1;
     if (self->exclusive_zone != exclusive_zone) {
         self->exclusive_zone = exclusive_zone;
+        trace_event ((CustomShellSurface *)self, TRACE_EVENT_STATE_CHANGE, "exclusive-zone", 1,
+                     exclusive_zone, 0, 0, 0);
         if (self->layer_surface) {
-            zwlr_layer_surface_v1_set_exclusive_zone (self->layer_surface, self->exclusive_zone);
+            layer_surface_send_set_exclusive_zone (self);
+            custom_shell_surface_latency_mark_change ((CustomShellSurface *)self,
+                                                      GTK_LAYER_SHELL_LATENCY_KIND_EXCLUSIVE_ZONE);
             custom_shell_surface_needs_commit ((CustomShellSurface *)self);
         }
     }
@@ -479,8 +911,11 @@ layer_surface_set_keyboard_mode (LayerSurface *self, GtkLayerShellKeyboardMode m
     }
     if (self->keyboard_mode != mode) {
         self->keyboard_mode = mode;
+        trace_event ((CustomShellSurface *)self, TRACE_EVENT_STATE_CHANGE, "keyboard-mode", 1, mode, 0, 0, 0);
         if (self->layer_surface) {
-            zwlr_layer_surface_v1_set_keyboard_interactivity (self->layer_surface, self->keyboard_mode);
+            layer_surface_send_set_keyboard_interactivity (self);
+            custom_shell_surface_latency_mark_change ((CustomShellSurface *)self,
+                                                      GTK_LAYER_SHELL_LATENCY_KIND_KEYBOARD_MODE);
             custom_shell_surface_needs_commit ((CustomShellSurface *)self);
         }
     }
@@ -494,3 +929,204 @@ layer_surface_get_namespace (LayerSurface *self)
     else
         return "gtk-layer-shell";
 }
+
+/*
+ * Called when the explicit or automatic opaque region is turned off
+ * GTK only recalculates its own region on allocation, so clear ours and queue one
+ */
+static void
+layer_surface_return_opaque_region_to_gtk (LayerSurface *self)
+{
+    GtkWindow *gtk_window = custom_shell_surface_get_gtk_window ((CustomShellSurface *)self);
+    GdkWindow *gdk_window = gtk_widget_get_window (GTK_WIDGET (gtk_window));
+    if (gdk_window)
+        gdk_window_set_opaque_region (gdk_window, NULL);
+    gtk_widget_queue_resize (GTK_WIDGET (gtk_window));
+}
+
+void
+layer_surface_set_opaque_region (LayerSurface *self, const cairo_region_t *region)
+{
+    // cairo_region_equal () treats NULL as equal only to itself
+    if (self->auto_opaque_region || !cairo_region_equal (self->opaque_region, region)) {
+        self->auto_opaque_region = FALSE;
+        g_clear_pointer (&self->opaque_region, cairo_region_destroy);
+        if (region)
+            self->opaque_region = cairo_region_copy (region);
+        trace_event ((CustomShellSurface *)self, TRACE_EVENT_STATE_CHANGE, "opaque-region", 1,
+                     region ? cairo_region_num_rectangles (region) : 0, 0, 0, 0);
+        if (self->opaque_region)
+            layer_surface_update_opaque_region (self);
+        else
+            layer_surface_return_opaque_region_to_gtk (self);
+        custom_shell_surface_needs_commit ((CustomShellSurface *)self);
+    }
+}
+
+void
+layer_surface_set_auto_opaque_region (LayerSurface *self, gboolean auto_opaque_region)
+{
+    auto_opaque_region = (auto_opaque_region != FALSE);
+    if (auto_opaque_region != self->auto_opaque_region) {
+        self->auto_opaque_region = auto_opaque_region;
+        g_clear_pointer (&self->opaque_region, cairo_region_destroy);
+        trace_event ((CustomShellSurface *)self, TRACE_EVENT_STATE_CHANGE, "auto-opaque-region", 1,
+                     auto_opaque_region, 0, 0, 0);
+        if (self->auto_opaque_region)
+            layer_surface_update_opaque_region (self);
+        else
+            layer_surface_return_opaque_region_to_gtk (self);
+        custom_shell_surface_needs_commit ((CustomShellSurface *)self);
+    }
+}
+
+void
+layer_surface_set_input_region (LayerSurface *self, const cairo_region_t *region)
+{
+    // cairo_region_equal () treats NULL as equal only to itself
+    if (self->click_through || !cairo_region_equal (self->input_region, region)) {
+        self->click_through = FALSE;
+        g_clear_pointer (&self->input_region, cairo_region_destroy);
+        if (region)
+            self->input_region = cairo_region_copy (region);
+        trace_event ((CustomShellSurface *)self, TRACE_EVENT_STATE_CHANGE, "input-region", 1,
+                     region ? cairo_region_num_rectangles (region) : 0, 0, 0, 0);
+        layer_surface_send_input_region (self);
+        custom_shell_surface_needs_commit ((CustomShellSurface *)self);
+    }
+}
+
+void
+layer_surface_set_click_through (LayerSurface *self, gboolean click_through)
+{
+    click_through = (click_through != FALSE);
+    if (click_through != self->click_through) {
+        self->click_through = click_through;
+        g_clear_pointer (&self->input_region, cairo_region_destroy);
+        trace_event ((CustomShellSurface *)self, TRACE_EVENT_STATE_CHANGE, "click-through", 1,
+                     click_through, 0, 0, 0);
+        layer_surface_send_input_region (self);
+        custom_shell_surface_needs_commit ((CustomShellSurface *)self);
+    }
+}
+
+void
+layer_surface_set_solid_color (LayerSurface *self, const GdkRGBA *color)
+{
+    if (color && (!gtk_wayland_get_single_pixel_buffer_manager_global () || !gtk_wayland_get_viewporter_global ())) {
+        g_warning ("Compositor does not support single pixel buffers and viewports, can not use a solid color");
+        color = NULL;
+    }
+
+    if (!color && !self->solid_color)
+        return;
+    if (color && self->solid_color && gdk_rgba_equal (color, self->solid_color))
+        return;
+
+    g_clear_pointer (&self->solid_color, gdk_rgba_free);
+    // Destroyed only after the new buffer is attached, so the surface always has a buffer
+    struct wl_buffer *old_buffer = self->solid_color_buffer;
+    self->solid_color_buffer = NULL;
+    if (color)
+        self->solid_color = gdk_rgba_copy (color);
+
+    trace_event ((CustomShellSurface *)self, TRACE_EVENT_STATE_CHANGE, "solid-color", 1, color != NULL, 0, 0, 0);
+    // A client buffer hides the color, so there is nothing to show until it is detached
+    if (!self->client_buffer)
+        layer_surface_update_content (self);
+
+    if (old_buffer)
+        wl_buffer_destroy (old_buffer);
+}
+
+// Returns the bytes per pixel of a wl_shm format, or 0 if the format isn't known
+static int
+layer_surface_get_shm_format_bytes_per_pixel (uint32_t format)
+{
+    switch (format) {
+        case WL_SHM_FORMAT_ARGB8888:
+        case WL_SHM_FORMAT_XRGB8888:
+        case WL_SHM_FORMAT_ABGR8888:
+        case WL_SHM_FORMAT_XBGR8888:
+        case WL_SHM_FORMAT_RGBA8888:
+        case WL_SHM_FORMAT_RGBX8888:
+        case WL_SHM_FORMAT_BGRA8888:
+        case WL_SHM_FORMAT_BGRX8888:
+        case WL_SHM_FORMAT_ARGB2101010:
+        case WL_SHM_FORMAT_XRGB2101010:
+        case WL_SHM_FORMAT_ABGR2101010:
+        case WL_SHM_FORMAT_XBGR2101010:
+            return 4;
+        case WL_SHM_FORMAT_RGB888:
+        case WL_SHM_FORMAT_BGR888:
+            return 3;
+        case WL_SHM_FORMAT_RGB565:
+        case WL_SHM_FORMAT_BGR565:
+        case WL_SHM_FORMAT_ARGB4444:
+        case WL_SHM_FORMAT_XRGB4444:
+        case WL_SHM_FORMAT_ARGB1555:
+        case WL_SHM_FORMAT_XRGB1555:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+gboolean
+layer_surface_attach_buffer (LayerSurface *self,
+                             int fd,
+                             int stride,
+                             uint32_t format,
+                             int width,
+                             int height,
+                             GtkLayerBufferReleaseFunc release_func,
+                             gpointer user_data)
+{
+    if (!gtk_wayland_get_shm_global ()) {
+        g_warning ("Compositor does not support wl_shm, can not attach a buffer");
+        return FALSE;
+    }
+    if (!gtk_wayland_get_viewporter_global ()) {
+        g_warning ("Compositor does not support viewports, can not attach a buffer");
+        return FALSE;
+    }
+    int bytes_per_pixel = layer_surface_get_shm_format_bytes_per_pixel (format);
+    if (!bytes_per_pixel || !gtk_wayland_get_shm_format_supported (format)) {
+        g_warning ("Compositor does not support buffer format 0x%08x, can not attach a buffer", format);
+        return FALSE;
+    }
+    if (fd < 0 || width <= 0 || height <= 0 || (gint64)stride < (gint64)width * bytes_per_pixel ||
+        (gint64)stride * height > G_MAXINT32) {
+        g_warning ("Can not attach invalid buffer (fd %d, stride %d, size %dx%d)", fd, stride, width, height);
+        return FALSE;
+    }
+
+    LayerSurfaceBuffer *buffer = g_new0 (LayerSurfaceBuffer, 1);
+    buffer->layer_surface = self;
+    buffer->release_func = release_func;
+    buffer->user_data = user_data;
+    buffer->busy = FALSE;
+    // The pool is only used to create the buffer, which keeps the memory mapped in the compositor on its own
+    struct wl_shm_pool *pool = wl_shm_create_pool (gtk_wayland_get_shm_global (), fd, stride * height);
+    buffer->wl_buffer = wl_shm_pool_create_buffer (pool, 0, width, height, stride, format);
+    wl_shm_pool_destroy (pool);
+    wl_buffer_add_listener (buffer->wl_buffer, &layer_surface_buffer_listener, buffer);
+
+    trace_event ((CustomShellSurface *)self, TRACE_EVENT_STATE_CHANGE, "client-buffer", 2, width, height, 0, 0);
+    // If it's still shown, the old buffer is only freed once the compositor switches to the new one
+    layer_surface_retire_client_buffer (self);
+    self->client_buffer = buffer;
+    layer_surface_update_content (self);
+    return TRUE;
+}
+
+void
+layer_surface_detach_buffer (LayerSurface *self)
+{
+    if (!self->client_buffer)
+        return;
+
+    trace_event ((CustomShellSurface *)self, TRACE_EVENT_STATE_CHANGE, "client-buffer", 2, 0, 0, 0, 0);
+    layer_surface_retire_client_buffer (self);
+    layer_surface_update_content (self);
+}
@@ -14,6 +14,8 @@
 
 #include "custom-shell-surface.h"
 #include "wlr-layer-shell-unstable-v1-client.h"
+#include "viewporter-client.h"
+#include "fractional-scale-v1-client.h"
 #include "gtk-layer-shell.h"
 #include <gtk/gtk.h>
 
@@ -22,6 +24,9 @@ static const gboolean default_respect_surface_closed = FALSE;
 // A LayerSurface * can be safely cast to a CustomShellSurface *
 typedef struct _LayerSurface LayerSurface;
 
+// A buffer from gtk_layer_attach_buffer (), private to layer-surface.c
+typedef struct _LayerSurfaceBuffer LayerSurfaceBuffer;
+
 // Functions that mutate this structure should all be in layer-surface.c to make the logic easier to understand
 // Struct is declared in this header to prevent the need for excess getters
 struct _LayerSurface
@@ -36,6 +41,10 @@ struct _LayerSurface
     GtkLayerShellKeyboardMode keyboard_mode; // Type of keyboard interactivity enabled for this surface
     GtkLayerShellLayer layer; // The current layer, needs surface recreation on old layer shell versions
     gboolean respect_surface_closed; // If to forward the .closed event to GTK
+    gboolean auto_opaque_region; // If to mark the whole surface opaque, kept in sync with its size
+    cairo_region_t *opaque_region; // Explicit opaque region (ignored if auto_opaque_region), NULL lets GTK decide
+    gboolean click_through; // If the surface should get no pointer or touch input at all
+    cairo_region_t *input_region; // Explicit input region (ignored if click_through), NULL means the whole surface
 
     // Need the surface to be recreated to change
     GdkMonitor *monitor; // Can be null
@@ -43,6 +52,13 @@ struct _LayerSurface
 
     // Not set by user requests
     struct zwlr_layer_surface_v1 *layer_surface; // The actual layer surface Wayland object (can be NULL)
+    struct wp_viewport *viewport; // Created along with layer_surface if the compositor supports it (can be NULL)
+    struct wp_fractional_scale_v1 *fractional_scale; // Same as viewport
+    uint32_t preferred_scale; // Last scale (in 120ths) the compositor said it prefers for this surface, or 0 if none
+    GdkRGBA *solid_color; // If set, the surface only shows this color and GTK doesn't draw it (can be NULL)
+    struct wl_buffer *solid_color_buffer; // Single pixel buffer of solid_color, created when first needed (can be NULL)
+    LayerSurfaceBuffer *client_buffer; // If set, shown instead of solid_color or what GTK draws (can be NULL)
+    GList *retired_buffers; // Replaced LayerSurfaceBuffers waiting for the compositor to release them
     gboolean remap_on_monitor_change; // If to attempt to remap the surface next time GTK detects a change to outputs
     GtkRequisition current_allocation; // Last size allocation, or (0, 0) if there hasn't been one
     GtkRequisition cached_layer_size; // Last size sent to zwlr_layer_surface_v1_set_size (starts as 0, 0)
@@ -65,6 +81,20 @@ void layer_surface_set_margin (LayerSurface *self, GtkLayerShellEdge edge, int m
 void layer_surface_set_exclusive_zone (LayerSurface *self, int exclusive_zone);
 void layer_surface_auto_exclusive_zone_enable (LayerSurface *self);
 void layer_surface_set_keyboard_mode (LayerSurface *self, GtkLayerShellKeyboardMode mode);
+void layer_surface_set_opaque_region (LayerSurface *self, const cairo_region_t *region); // Makes a copy, can be null
+void layer_surface_set_auto_opaque_region (LayerSurface *self, gboolean auto_opaque_region);
+void layer_surface_set_input_region (LayerSurface *self, const cairo_region_t *region); // Makes a copy, can be null
+void layer_surface_set_click_through (LayerSurface *self, gboolean click_through);
+void layer_surface_set_solid_color (LayerSurface *self, const GdkRGBA *color); // Makes a copy, can be null
+gboolean layer_surface_attach_buffer (LayerSurface *self, // Does not take ownership of fd
+                                      int fd,
+                                      int stride,
+                                      uint32_t format,
+                                      int width,
+                                      int height,
+                                      GtkLayerBufferReleaseFunc release_func,
+                                      gpointer user_data);
+void layer_surface_detach_buffer (LayerSurface *self);
 
 // Returns the effective namespace (default if unset). Does not return ownership. Never returns NULL. Handles null self.
 const char* layer_surface_get_namespace (LayerSurface *self);
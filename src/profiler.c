@@ -0,0 +1,34 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "profiler.h"
+
+#ifdef HAVE_SYSPROF
+
+#include <sysprof-capture.h>
+
+static const char *profiler_group = "gtk-layer-shell";
+
+gint64
+profiler_current_time (void)
+{
+    return SYSPROF_CAPTURE_CURRENT_TIME;
+}
+
+void
+profiler_add_mark (gint64 begin_time, const char *name)
+{
+    gint64 duration = SYSPROF_CAPTURE_CURRENT_TIME - begin_time;
+    sysprof_collector_mark (begin_time, duration, profiler_group, name, NULL);
+}
+
+#endif // HAVE_SYSPROF
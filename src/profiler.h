@@ -0,0 +1,45 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glib.h>
+
+// Sysprof marks, only emitted when built with -Dsysprof=true. Otherwise these all compile to nothing.
+
+#ifdef HAVE_SYSPROF
+
+// Returns the current time in the clock sysprof uses, to later be passed to profiler_add_mark ()
+gint64 profiler_current_time (void);
+
+// Adds a mark spanning from begin_time (as returned by profiler_current_time ()) until now
+void profiler_add_mark (gint64 begin_time, const char *name);
+
+#else // HAVE_SYSPROF
+
+static inline gint64
+profiler_current_time (void)
+{
+    return 0;
+}
+
+static inline void
+profiler_add_mark (gint64 begin_time, const char *name)
+{
+    (void)begin_time;
+    (void)name;
+}
+
+#endif // HAVE_SYSPROF
+
+#endif // PROFILER_H
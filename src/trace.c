@@ -0,0 +1,140 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "trace.h"
+
+#include <glib-unix.h>
+#include <signal.h>
+#include <stdio.h>
+
+#define TRACE_BUFFER_SIZE 4096
+
+typedef struct {
+    gint64 time; // Monotonic time in microseconds
+    guint surface_id; // 0 if the event is not associated with a surface
+    TraceEventType type;
+    const char *name;
+    guint n_args;
+    gint64 args[TRACE_MAX_ARGS];
+} TraceEvent;
+
+static const char *trace_event_type_names[TRACE_EVENT_ENTRY_NUMBER] = {
+    [TRACE_EVENT_STATE_CHANGE] = "state-change",
+    [TRACE_EVENT_REQUEST] = "request",
+    [TRACE_EVENT_CONFIGURE] = "configure",
+    [TRACE_EVENT_ACK] = "ack",
+    [TRACE_EVENT_COMMIT] = "commit",
+    [TRACE_EVENT_MAP] = "map",
+    [TRACE_EVENT_UNMAP] = "unmap",
+    [TRACE_EVENT_REMAP] = "remap",
+    [TRACE_EVENT_LATENCY] = "latency",
+    [TRACE_EVENT_PRESENT] = "present",
+};
+
+static gboolean trace_initialized = FALSE;
+static TraceEvent *trace_buffer = NULL; // NULL when tracing is disabled
+static guint64 trace_total_events = 0; // Events ever recorded, the next one goes at trace_total_events % buffer size
+
+static gboolean
+trace_on_dump_signal (gpointer _data)
+{
+    (void)_data;
+
+    char *json = trace_dump_json ();
+    fprintf (stderr, "%s\n", json);
+    fflush (stderr);
+    g_free (json);
+    return G_SOURCE_CONTINUE;
+}
+
+void
+trace_init (void)
+{
+    if (trace_initialized)
+        return;
+    trace_initialized = TRUE;
+
+    const char *env = g_getenv ("GTK_LAYER_SHELL_TRACE");
+    if (!env || !*env || g_strcmp0 (env, "0") == 0)
+        return;
+
+    trace_buffer = g_new0 (TraceEvent, TRACE_BUFFER_SIZE);
+    // Lets a trace be pulled out of an app that doesn't call gtk_layer_get_trace () with kill -USR2
+    g_unix_signal_add (SIGUSR2, trace_on_dump_signal, NULL);
+}
+
+gboolean
+trace_get_enabled (void)
+{
+    return trace_buffer != NULL;
+}
+
+void
+trace_event (CustomShellSurface *surface,
+             TraceEventType type,
+             const char *name,
+             guint n_args,
+             gint64 arg_0,
+             gint64 arg_1,
+             gint64 arg_2,
+             gint64 arg_3)
+{
+    if (G_LIKELY (!trace_buffer))
+        return;
+
+    TraceEvent *event = &trace_buffer[trace_total_events % TRACE_BUFFER_SIZE];
+    trace_total_events++;
+
+    event->time = g_get_monotonic_time ();
+    event->surface_id = surface ? custom_shell_surface_get_id (surface) : 0;
+    event->type = type;
+    event->name = name;
+    event->n_args = MIN (n_args, TRACE_MAX_ARGS);
+    event->args[0] = arg_0;
+    event->args[1] = arg_1;
+    event->args[2] = arg_2;
+    event->args[3] = arg_3;
+}
+
+char *
+trace_dump_json (void)
+{
+    if (!trace_buffer)
+        return NULL;
+
+    guint64 first = trace_total_events > TRACE_BUFFER_SIZE ? trace_total_events - TRACE_BUFFER_SIZE : 0;
+    GString *json = g_string_new (NULL);
+    g_string_append_printf (json, "{\"dropped\":%" G_GUINT64_FORMAT ",\"events\":[", first);
+    for (guint64 i = first; i < trace_total_events; i++) {
+        TraceEvent *event = &trace_buffer[i % TRACE_BUFFER_SIZE];
+        if (i != first)
+            g_string_append_c (json, ',');
+        g_string_append_printf (json,
+                                "{\"time\":%" G_GINT64_FORMAT ",\"surface\":%u,\"type\":\"%s\"",
+                                event->time,
+                                event->surface_id,
+                                trace_event_type_names[event->type]);
+        // Names are static strings from our own source, so they never need escaping
+        if (event->name)
+            g_string_append_printf (json, ",\"name\":\"%s\"", event->name);
+        if (event->n_args) {
+            g_string_append (json, ",\"args\":[");
+            for (guint arg = 0; arg < event->n_args; arg++) {
+                g_string_append_printf (json, "%s%" G_GINT64_FORMAT, arg ? "," : "", event->args[arg]);
+            }
+            g_string_append_c (json, ']');
+        }
+        g_string_append_c (json, '}');
+    }
+    g_string_append (json, "]}");
+    return g_string_free (json, FALSE);
+}
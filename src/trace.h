@@ -0,0 +1,62 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "custom-shell-surface.h"
+
+#include <glib.h>
+
+// A structured log of what each surface is doing, enabled by setting GTK_LAYER_SHELL_TRACE=1. Events are written into a
+// fixed size ring buffer that is allocated once, so recording never allocates. When tracing is disabled all of these
+// functions return immediately.
+
+typedef enum {
+    TRACE_EVENT_STATE_CHANGE, // name is the property that changed, args[0] is the new value
+    TRACE_EVENT_REQUEST, // name is the request sent, args are its integer arguments
+    TRACE_EVENT_CONFIGURE, // name is the event received, args are its integer arguments
+    TRACE_EVENT_ACK, // args[0] is the serial acked
+    TRACE_EVENT_COMMIT,
+    TRACE_EVENT_MAP,
+    TRACE_EVENT_UNMAP,
+    TRACE_EVENT_REMAP,
+    TRACE_EVENT_LATENCY, // name is the latency probe kind, args[0] is the stage and args[1] the latency in microseconds
+    // Only recorded for presentation feedback requested anyway (by a presentation callback or the latency probe).
+    // args[0] is the latency from commit to presentation in microseconds (-1 if discarded), args[1] the refresh
+    // interval in microseconds (0 if unknown) and args[2] the number of missed frames
+    TRACE_EVENT_PRESENT,
+    TRACE_EVENT_ENTRY_NUMBER, // Should not be used as a value, only as the number of entries
+} TraceEventType;
+
+#define TRACE_MAX_ARGS 4
+
+// Reads the environment and allocates the ring buffer if tracing is requested, safe to call multiple times
+void trace_init (void);
+
+gboolean trace_get_enabled (void);
+
+// Records an event. surface may be NULL. name must be a static string (it is stored but not copied) and may be NULL.
+// n_args is how many of the args are meaningful, the rest should be 0.
+void trace_event (CustomShellSurface *surface,
+                  TraceEventType type,
+                  const char *name,
+                  guint n_args,
+                  gint64 arg_0,
+                  gint64 arg_1,
+                  gint64 arg_2,
+                  gint64 arg_3);
+
+// Returns the buffered events (oldest first) as a newly allocated JSON string, or NULL if tracing is disabled
+char *trace_dump_json (void);
+
+#endif // TRACE_H
@@ -15,6 +15,8 @@
 #include "gtk-wayland.h"
 #include "simple-conversions.h"
 #include "gtk-priv-access.h"
+#include "profiler.h"
+#include "trace.h"
 
 #include "xdg-shell-client.h"
 
@@ -44,8 +46,9 @@ xdg_surface_handle_configure (void *data,
     XdgPopupSurface *self = data;
     (void)_xdg_surface;
 
+    trace_event ((CustomShellSurface *)self, TRACE_EVENT_CONFIGURE, "xdg_surface.configure", 1, serial, 0, 0, 0);
     xdg_surface_ack_configure (self->xdg_surface, serial);
-    self->super.awaiting_initial_configure = FALSE;
+    custom_shell_surface_handle_configure ((CustomShellSurface *)self, serial);
 }
 
 static const struct xdg_surface_listener xdg_surface_listener = {
@@ -64,6 +67,7 @@ xdg_popup_handle_configure (void *data,
     gint cur_width, cur_height;
     (void)_xdg_popup;
 
+    trace_event ((CustomShellSurface *)self, TRACE_EVENT_CONFIGURE, "xdg_popup.configure", 4, x, y, width, height);
     g_return_if_fail(width >= 0 && height >= 0); // Protocol error
 
     // Technically this should not be applied until we get a xdg_surface.configure
@@ -161,6 +165,7 @@ static void
 xdg_popup_surface_map (CustomShellSurface *super, struct wl_surface *wl_surface)
 {
     XdgPopupSurface *self = (XdgPopupSurface *)super;
+    gint64 profiler_start_time = profiler_current_time ();
 
     g_return_if_fail (!self->xdg_popup);
     g_return_if_fail (!self->xdg_surface);
@@ -212,6 +217,7 @@ xdg_popup_surface_map (CustomShellSurface *super, struct wl_surface *wl_surface)
     xdg_positioner_destroy (positioner);
 
     xdg_popup_surface_maybe_grab (self, gdk_window);
+    profiler_add_mark (profiler_start_time, "popup map");
 }
 
 static void
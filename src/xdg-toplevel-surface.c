@@ -15,6 +15,7 @@
 #include "gtk-wayland.h"
 #include "simple-conversions.h"
 #include "gtk-priv-access.h"
+#include "trace.h"
 
 #include "xdg-shell-client.h"
 
@@ -41,8 +42,9 @@ xdg_surface_handle_configure (void *data,
 {
     XdgToplevelSurface *self = data;
 
+    trace_event ((CustomShellSurface *)self, TRACE_EVENT_CONFIGURE, "xdg_surface.configure", 1, serial, 0, 0, 0);
     xdg_surface_ack_configure (xdg_surface, serial);
-    self->super.awaiting_initial_configure = FALSE;
+    custom_shell_surface_handle_configure ((CustomShellSurface *)self, serial);
 }
 
 static const struct xdg_surface_listener xdg_surface_listener = {
@@ -60,6 +62,7 @@ xdg_toplevel_handle_configure (void *data,
     (void)_xdg_toplevel;
     (void)_states;
 
+    trace_event ((CustomShellSurface *)self, TRACE_EVENT_CONFIGURE, "xdg_toplevel.configure", 2, width, height, 0, 0);
     // Technically this should not be applied until we get a xdg_surface.configure
     if (width > 0 || height > 0) {
         GtkWindow *gtk_window = custom_shell_surface_get_gtk_window ((CustomShellSurface *)self);
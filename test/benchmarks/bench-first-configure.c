@@ -0,0 +1,40 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "integration-test-common.h"
+
+// Time from showing a layer surface until it has been configured (mapping blocks until the initial configure arrives)
+static void run(int count)
+{
+    GtkWindow** windows = g_new0(GtkWindow*, count + 1);
+    gint64 total_time = 0;
+    for (int i = 0; i < count; i++) {
+        windows[i] = create_default_window();
+        gtk_layer_init_for_window(windows[i]);
+        gint64 start = g_get_monotonic_time();
+        gtk_widget_show_all(GTK_WIDGET(windows[i]));
+        total_time += g_get_monotonic_time() - start;
+    }
+
+    BENCHMARK_RESULT(total_time / count, "us", "first-configure/%d", count);
+
+    destroy_benchmark_windows(windows);
+}
+
+static void callback_0()
+{
+    run_benchmark_for_each_surface_count(run);
+}
+
+TEST_CALLBACKS(
+    callback_0,
+)
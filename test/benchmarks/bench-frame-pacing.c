@@ -0,0 +1,108 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "integration-test-common.h"
+#include <time.h>
+#include <math.h>
+
+// How long to animate at each refresh rate
+#define RUN_TIME_US (G_USEC_PER_SEC / 2)
+
+static int frames = 0;
+static gint64 last_frame_time = 0;
+static double interval_sum = 0;
+static double interval_square_sum = 0;
+
+static gboolean on_tick(GtkWidget* widget, GdkFrameClock* _frame_clock, gpointer _data)
+{
+    (void)_frame_clock; (void)_data;
+    // Animate continuously, so a new frame is drawn as soon as the compositor allows
+    gtk_widget_queue_draw(widget);
+    return G_SOURCE_CONTINUE;
+}
+
+static void on_after_paint(GdkFrameClock* _frame_clock, gpointer _data)
+{
+    (void)_frame_clock; (void)_data;
+    gint64 now = g_get_monotonic_time();
+    if (last_frame_time) {
+        double interval = (now - last_frame_time) / 1000.0;
+        interval_sum += interval;
+        interval_square_sum += interval * interval;
+    }
+    last_frame_time = now;
+    frames++;
+}
+
+// CPU time of this thread only, since the in-process mock server's vblank timers and hashing run on another one
+static double cpu_time_us()
+{
+    struct timespec now;
+    ASSERT(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) == 0);
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+// Frame rate, frame interval jitter and CPU time per frame of an animating layer surface, with frame callbacks paced
+// by the mock server at the given refresh rate
+static void run(int hz, double drop_rate)
+{
+    char command[64];
+    snprintf(command, sizeof(command), "set_refresh_rate 0 %d", hz);
+    send_command(command, "refresh_rate_set");
+    snprintf(command, sizeof(command), "set_frame_drop_rate %f", drop_rate);
+    send_command(command, "frame_drop_rate_set");
+
+    GtkWindow* window = create_default_window();
+    gtk_layer_init_for_window(window);
+    gtk_widget_add_tick_callback(GTK_WIDGET(window), on_tick, NULL, NULL);
+    gtk_widget_show_all(GTK_WIDGET(window));
+    settle_events();
+    GdkFrameClock* frame_clock = gdk_window_get_frame_clock(gtk_widget_get_window(GTK_WIDGET(window)));
+    g_signal_connect(frame_clock, "after-paint", G_CALLBACK(on_after_paint), NULL);
+
+    frames = 0;
+    last_frame_time = 0;
+    interval_sum = interval_square_sum = 0;
+    double cpu_start = cpu_time_us();
+    gint64 start = g_get_monotonic_time();
+    while (g_get_monotonic_time() - start < RUN_TIME_US) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    double seconds = (g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC;
+    double cpu = cpu_time_us() - cpu_start;
+
+    int intervals = MAX(frames - 1, 1);
+    double mean_interval = interval_sum / intervals;
+    double jitter = sqrt(MAX(interval_square_sum / intervals - mean_interval * mean_interval, 0));
+
+    BENCHMARK_RESULT(frames / seconds, "fps", "paced-frame-rate/%dhz/drop-%.2f", hz, drop_rate);
+    BENCHMARK_RESULT(jitter, "ms-stddev", "paced-frame-jitter/%dhz/drop-%.2f", hz, drop_rate);
+    BENCHMARK_RESULT(cpu / MAX(frames, 1), "us-per-frame", "paced-frame-cpu/%dhz/drop-%.2f", hz, drop_rate);
+
+    g_signal_handlers_disconnect_by_func(frame_clock, on_after_paint, NULL);
+    gtk_widget_destroy(GTK_WIDGET(window));
+    settle_events();
+}
+
+static void callback_0()
+{
+    send_command("set_frame_pacing refresh", "frame_pacing_set");
+    int rates[] = {30, 60, 144};
+    for (size_t i = 0; i < G_N_ELEMENTS(rates); i++) {
+        run(rates[i], 0);
+    }
+    run(60, 0.1);
+}
+
+TEST_CALLBACKS(
+    callback_0,
+)
@@ -0,0 +1,156 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "integration-test-common.h"
+
+// Each hotplug is an output being created or destroyed
+#define STORM_CYCLES 10
+// Outputs created before the storm, with surfaces on them, that the storm destroys
+#define HOSTING_OUTPUTS 2
+
+static int next_output_id = 1; // The mock server starts with one output and never reuses ids
+static int map_count = 0;
+
+static void on_map(GtkWidget* _widget, gpointer _data)
+{
+    (void)_widget; (void)_data;
+    map_count++;
+}
+
+// Creates the outputs that some surfaces are put on and fills in their monitors. Returns the id of the first one.
+static int create_hosting_outputs(GdkMonitor** monitors)
+{
+    int first_id = next_output_id;
+    for (int i = 0; i < HOSTING_OUTPUTS; i++) {
+        send_command("create_output 1920 1080", "output_created");
+        next_output_id++;
+    }
+    settle_events();
+    GdkDisplay* display = gdk_display_get_default();
+    int monitor_count = gdk_display_get_n_monitors(display);
+    ASSERT_EQ(monitor_count, HOSTING_OUTPUTS + 1, "%d");
+    for (int i = 0; i < HOSTING_OUTPUTS; i++) {
+        monitors[i] = gdk_display_get_monitor(display, monitor_count - HOSTING_OUTPUTS + i);
+    }
+    return first_id;
+}
+
+// Sends every hotplug as one batch, so the server runs them all in a single turn of its event loop. Destroys the
+// hosting outputs first, so the surfaces on them are closed and the others remapped while the rest of the storm is
+// still arriving.
+static void hotplug_storm(int first_hosting_output_id)
+{
+    const char* commands[HOSTING_OUTPUTS + STORM_CYCLES * 2];
+    const char* responses[HOSTING_OUTPUTS + STORM_CYCLES * 2];
+    char destroy_commands[HOSTING_OUTPUTS + STORM_CYCLES][64];
+    int command_count = 0;
+    for (int i = 0; i < HOSTING_OUTPUTS; i++) {
+        snprintf(
+            destroy_commands[i], sizeof(destroy_commands[i]),
+            "destroy_output %d", first_hosting_output_id + i);
+        commands[command_count] = destroy_commands[i];
+        responses[command_count] = "output_destroyed";
+        command_count++;
+    }
+    for (int i = 0; i < STORM_CYCLES; i++) {
+        char* destroy_command = destroy_commands[HOSTING_OUTPUTS + i];
+        snprintf(destroy_command, sizeof(destroy_commands[0]), "destroy_output %d", next_output_id);
+        next_output_id++;
+        commands[command_count] = "create_output 1280 720";
+        responses[command_count] = "output_created";
+        command_count++;
+        commands[command_count] = destroy_command;
+        responses[command_count] = "output_destroyed";
+        command_count++;
+    }
+    send_command_batch(commands, responses, command_count);
+}
+
+// Resets the peak resident memory of this process to its current resident memory
+static void reset_peak_resident()
+{
+    FILE* clear_refs = fopen("/proc/self/clear_refs", "w");
+    ASSERT(clear_refs);
+    ASSERT(fputs("5", clear_refs) >= 0);
+    ASSERT(fclose(clear_refs) == 0);
+}
+
+// Reads a field in KiB (such as "VmRSS" or "VmHWM") from the status of this process. Run out-of-process (see
+// meson.build), so the mock server isn't included.
+static long status_kib(const char* field)
+{
+    FILE* status = fopen("/proc/self/status", "r");
+    ASSERT(status);
+    size_t field_length = strlen(field);
+    char line[256];
+    long kib = -1;
+    while (fgets(line, sizeof(line), status)) {
+        if (strncmp(line, field, field_length) == 0 && line[field_length] == ':') {
+            ASSERT(sscanf(line + field_length + 1, "%ld", &kib) == 1);
+            break;
+        }
+    }
+    fclose(status);
+    ASSERT(kib >= 0);
+    return kib;
+}
+
+// Rapidly adds and removes outputs while the given number of layer surfaces exist, without letting the client process
+// anything in between. Every other surface is put on one of the hosting outputs, and the rest are left for the
+// compositor to place, so they are remapped when the monitors change.
+static void run(int count)
+{
+    GdkMonitor* hosting_monitors[HOSTING_OUTPUTS];
+    int first_hosting_output_id = create_hosting_outputs(hosting_monitors);
+    GtkWindow** windows = g_new0(GtkWindow*, count + 1);
+    for (int i = 0; i < count; i++) {
+        windows[i] = create_default_window();
+        gtk_layer_init_for_window(windows[i]);
+        gtk_layer_set_anchor(windows[i], GTK_LAYER_SHELL_EDGE_TOP, TRUE);
+        if (i % 2) {
+            gtk_layer_set_monitor(windows[i], hosting_monitors[(i / 2) % HOSTING_OUTPUTS]);
+        }
+        g_signal_connect(windows[i], "map", G_CALLBACK(on_map), NULL);
+        gtk_widget_show_all(GTK_WIDGET(windows[i]));
+    }
+    settle_events();
+
+    // Measured from after the surfaces exist, so only what the storm costs is counted
+    reset_peak_resident();
+    long resident_before = status_kib("VmRSS");
+    map_count = 0;
+    long requests_before = get_mock_server_stat("requests");
+    gint64 start = g_get_monotonic_time();
+    hotplug_storm(first_hosting_output_id);
+    settle_events();
+    gint64 settle_time = g_get_monotonic_time() - start;
+    long requests = get_mock_server_stat("requests") - requests_before;
+    int hotplugs = HOSTING_OUTPUTS + STORM_CYCLES * 2;
+
+    long peak_growth = status_kib("VmHWM") - resident_before;
+
+    BENCHMARK_RESULT(map_count / (double)hotplugs, "remaps-per-hotplug", "hotplug-remaps/%d", count);
+    BENCHMARK_RESULT(settle_time, "us", "hotplug-settle-time/%d", count);
+    BENCHMARK_RESULT(requests / (double)hotplugs, "requests-per-hotplug", "hotplug-requests/%d", count);
+    BENCHMARK_RESULT(peak_growth, "KiB", "hotplug-peak-rss-growth/%d", count);
+
+    destroy_benchmark_windows(windows);
+}
+
+static void callback_0()
+{
+    run_benchmark_for_each_surface_count(run);
+}
+
+TEST_CALLBACKS(
+    callback_0,
+)
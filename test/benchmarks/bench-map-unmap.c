@@ -0,0 +1,45 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "integration-test-common.h"
+
+// Map/unmap cycles per second while the given number of layer surfaces exist
+static void run(int count)
+{
+    GtkWindow** windows = create_benchmark_windows(count);
+
+    int cycles = MAX(2, 200 / count);
+    gint64 start = g_get_monotonic_time();
+    for (int cycle = 0; cycle < cycles; cycle++) {
+        for (int i = 0; i < count; i++) {
+            gtk_widget_hide(GTK_WIDGET(windows[i]));
+        }
+        for (int i = 0; i < count; i++) {
+            gtk_widget_show(GTK_WIDGET(windows[i]));
+        }
+        settle_events();
+    }
+    double seconds = (g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC;
+
+    BENCHMARK_RESULT(cycles * count / seconds, "per-second", "map-unmap/%d", count);
+
+    destroy_benchmark_windows(windows);
+}
+
+static void callback_0()
+{
+    run_benchmark_for_each_surface_count(run);
+}
+
+TEST_CALLBACKS(
+    callback_0,
+)
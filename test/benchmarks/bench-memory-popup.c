@@ -0,0 +1,42 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "integration-test-common.h"
+
+// Keeps the given number of popups open on a single layer surface, run-integration-test.py --massif measures the
+// memory per popup
+static GtkWindow** windows;
+static GtkWindow** popups;
+
+static void callback_0()
+{
+    int count = get_benchmark_surface_count();
+    windows = create_benchmark_windows(1);
+    popups = g_new0(GtkWindow*, count + 1);
+    for (int i = 0; i < count; i++) {
+        popups[i] = create_benchmark_popup(windows[0]);
+        gtk_widget_show(GTK_WIDGET(popups[i]));
+    }
+    // Let every popup be configured and draw, so the buffers GDK keeps for each are allocated
+    settle_events();
+}
+
+static void callback_1()
+{
+    destroy_benchmark_windows(popups);
+    destroy_benchmark_windows(windows);
+}
+
+TEST_CALLBACKS(
+    callback_0,
+    callback_1,
+)
@@ -0,0 +1,82 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "integration-test-common.h"
+
+// How long the panel runs for
+#define RUN_TIME_US G_USEC_PER_SEC
+// How often the panel's clock label changes
+#define CLOCK_INTERVAL_MS 100
+
+static GtkLabel* clock_label;
+static int ticks = 0;
+
+static gboolean on_clock_tick(gpointer _data)
+{
+    (void)_data;
+    char text[32];
+    snprintf(text, sizeof(text), "tick %d", ++ticks);
+    gtk_label_set_text(clock_label, text);
+    return G_SOURCE_CONTINUE;
+}
+
+// Bandwidth of a typical panel: stretched across the top of the output, with a clock that changes several times per
+// second, and frame callbacks paced at 60Hz
+static void callback_0()
+{
+    send_command("set_frame_pacing refresh", "frame_pacing_set");
+
+    GtkWindow* window = GTK_WINDOW(gtk_window_new(GTK_WINDOW_TOPLEVEL));
+    gtk_layer_init_for_window(window);
+    gtk_layer_set_anchor(window, GTK_LAYER_SHELL_EDGE_TOP, TRUE);
+    gtk_layer_set_anchor(window, GTK_LAYER_SHELL_EDGE_LEFT, TRUE);
+    gtk_layer_set_anchor(window, GTK_LAYER_SHELL_EDGE_RIGHT, TRUE);
+    gtk_layer_auto_exclusive_zone_enable(window);
+    GtkWidget* box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
+    gtk_box_pack_start(GTK_BOX(box), gtk_label_new("Panel"), FALSE, FALSE, 6);
+    clock_label = GTK_LABEL(gtk_label_new("tick 0"));
+    gtk_box_pack_end(GTK_BOX(box), GTK_WIDGET(clock_label), FALSE, FALSE, 6);
+    gtk_container_add(GTK_CONTAINER(window), box);
+    gtk_widget_show_all(GTK_WIDGET(window));
+    settle_events();
+
+    long commits_before = get_mock_server_stat("commits");
+    long bytes_before = get_mock_server_stat("bytes_attached");
+    long damage_before = get_mock_server_stat("damage_area");
+    long unchanged_before = get_mock_server_stat("unchanged_commits");
+    guint clock = g_timeout_add(CLOCK_INTERVAL_MS, on_clock_tick, NULL);
+    gint64 start = g_get_monotonic_time();
+    while (g_get_monotonic_time() - start < RUN_TIME_US) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    g_source_remove(clock);
+    settle_events();
+    double seconds = (g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC;
+    long commits = get_mock_server_stat("commits") - commits_before;
+
+    BENCHMARK_RESULT(
+        (get_mock_server_stat("bytes_attached") - bytes_before) / seconds, "bytes-per-second",
+        "panel-bytes-attached");
+    BENCHMARK_RESULT(
+        (get_mock_server_stat("damage_area") - damage_before) / seconds, "pixels-per-second",
+        "panel-damage-area");
+    BENCHMARK_RESULT(commits / seconds, "per-second", "panel-commits");
+    BENCHMARK_RESULT(
+        (get_mock_server_stat("unchanged_commits") - unchanged_before) / (double)MAX(commits, 1), "fraction",
+        "panel-unchanged-commits");
+
+    gtk_widget_destroy(GTK_WIDGET(window));
+}
+
+TEST_CALLBACKS(
+    callback_0,
+)
@@ -0,0 +1,69 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "integration-test-common.h"
+
+static int windows_not_yet_painted = 0;
+
+static void on_after_paint(GdkFrameClock* _frame_clock, gboolean* painted)
+{
+    (void)_frame_clock;
+    if (!*painted) {
+        *painted = TRUE;
+        windows_not_yet_painted--;
+    }
+}
+
+// Margin changes per second that make it all the way to a commit, spread across the given number of layer surfaces
+static void run(int count)
+{
+    GtkWindow** windows = create_benchmark_windows(count);
+    gboolean* painted = g_new0(gboolean, count);
+    for (int i = 0; i < count; i++) {
+        GdkFrameClock* frame_clock = gdk_window_get_frame_clock(gtk_widget_get_window(GTK_WIDGET(windows[i])));
+        g_signal_connect(frame_clock, "after-paint", G_CALLBACK(on_after_paint), &painted[i]);
+    }
+
+    int batches = MAX(5, 200 / count);
+    gint64 start = g_get_monotonic_time();
+    for (int batch = 0; batch < batches; batch++) {
+        windows_not_yet_painted = count;
+        for (int i = 0; i < count; i++) {
+            painted[i] = FALSE;
+            gtk_layer_set_margin(windows[i], GTK_LAYER_SHELL_EDGE_TOP, batch % 2 ? 10 : 20);
+        }
+        // GDK commits the change when it paints
+        while (windows_not_yet_painted > 0) {
+            g_main_context_iteration(NULL, TRUE);
+        }
+        wl_display_roundtrip(gdk_wayland_display_get_wl_display(gdk_display_get_default()));
+    }
+    double seconds = (g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC;
+
+    BENCHMARK_RESULT(batches * count / seconds, "per-second", "property-change/%d", count);
+
+    for (int i = 0; i < count; i++) {
+        GdkFrameClock* frame_clock = gdk_window_get_frame_clock(gtk_widget_get_window(GTK_WIDGET(windows[i])));
+        g_signal_handlers_disconnect_by_data(frame_clock, &painted[i]);
+    }
+    g_free(painted);
+    destroy_benchmark_windows(windows);
+}
+
+static void callback_0()
+{
+    run_benchmark_for_each_surface_count(run);
+}
+
+TEST_CALLBACKS(
+    callback_0,
+)
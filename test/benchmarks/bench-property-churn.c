@@ -0,0 +1,191 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "integration-test-common.h"
+
+// Number of changes made of each kind on its own, and then of all kinds mixed together
+#define CHANGES_PER_KIND 100
+#define MIXED_CHANGES 1000
+
+typedef enum {
+    CHANGE_ANCHOR,
+    CHANGE_MARGIN,
+    CHANGE_EXCLUSIVE_ZONE,
+    CHANGE_LAYER,
+    CHANGE_KEYBOARD_MODE,
+    CHANGE_KIND_COUNT,
+} ChangeKind;
+
+static const char* change_kind_names[CHANGE_KIND_COUNT] = {
+    [CHANGE_ANCHOR] = "anchor",
+    [CHANGE_MARGIN] = "margin",
+    [CHANGE_EXCLUSIVE_ZONE] = "exclusive-zone",
+    [CHANGE_LAYER] = "layer",
+    [CHANGE_KEYBOARD_MODE] = "keyboard-mode",
+};
+
+typedef struct {
+    long requests;
+    long commits;
+    long attaches;
+    long bytes_attached;
+    long damage_area;
+    long unchanged_commits;
+} Traffic;
+
+static GtkWindow* window;
+static GRand* rng;
+static gboolean painted = FALSE;
+static double settle_requests = 0; // Requests settle_events() makes on its own, subtracted from each change
+
+static Traffic get_traffic()
+{
+    return (Traffic){
+        .requests = get_mock_server_stat("requests"),
+        .commits = get_mock_server_stat("commits"),
+        .attaches = get_mock_server_stat("attaches"),
+        .bytes_attached = get_mock_server_stat("bytes_attached"),
+        .damage_area = get_mock_server_stat("damage_area"),
+        .unchanged_commits = get_mock_server_stat("unchanged_commits"),
+    };
+}
+
+static void on_after_paint(GdkFrameClock* _frame_clock, gpointer _data)
+{
+    (void)_frame_clock; (void)_data;
+    painted = TRUE;
+}
+
+static gboolean on_timeout(gpointer data)
+{
+    *(gboolean*)data = TRUE;
+    return G_SOURCE_REMOVE;
+}
+
+// Every change invalidates the window, so wait for GDK to paint (and so commit) before counting the traffic
+static void wait_for_commit()
+{
+    gboolean timed_out = FALSE;
+    guint timeout = g_timeout_add(100, on_timeout, &timed_out);
+    while (!painted && !timed_out) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    if (!timed_out) {
+        g_source_remove(timeout);
+    }
+    settle_events();
+}
+
+// Always changes the property to a value different from its current one, so each call is one logical change
+static void apply_random_change(ChangeKind kind)
+{
+    GtkLayerShellEdge edge = g_rand_int_range(rng, 0, GTK_LAYER_SHELL_EDGE_ENTRY_NUMBER);
+    switch (kind) {
+        case CHANGE_ANCHOR:
+            gtk_layer_set_anchor(window, edge, !gtk_layer_get_anchor(window, edge));
+            break;
+
+        case CHANGE_MARGIN: {
+            int margin;
+            do margin = g_rand_int_range(rng, 0, 100); while (margin == gtk_layer_get_margin(window, edge));
+            gtk_layer_set_margin(window, edge, margin);
+            break;
+        }
+
+        case CHANGE_EXCLUSIVE_ZONE: {
+            int zone;
+            do zone = g_rand_int_range(rng, -1, 200); while (zone == gtk_layer_get_exclusive_zone(window));
+            gtk_layer_set_exclusive_zone(window, zone);
+            break;
+        }
+
+        case CHANGE_LAYER: {
+            GtkLayerShellLayer layer;
+            do layer = g_rand_int_range(rng, 0, GTK_LAYER_SHELL_LAYER_ENTRY_NUMBER);
+            while (layer == gtk_layer_get_layer(window));
+            gtk_layer_set_layer(window, layer);
+            break;
+        }
+
+        case CHANGE_KEYBOARD_MODE: {
+            GtkLayerShellKeyboardMode mode;
+            do mode = g_rand_int_range(rng, 0, GTK_LAYER_SHELL_KEYBOARD_MODE_ENTRY_NUMBER);
+            while (mode == gtk_layer_get_keyboard_mode(window));
+            gtk_layer_set_keyboard_mode(window, mode);
+            break;
+        }
+
+        default:
+            FATAL_FMT("invalid change kind %d", kind);
+    }
+}
+
+// If kind is CHANGE_KIND_COUNT, each change is of a random kind
+static void run(const char* name, ChangeKind kind, int changes)
+{
+    Traffic before = get_traffic();
+    for (int i = 0; i < changes; i++) {
+        painted = FALSE;
+        apply_random_change(kind == CHANGE_KIND_COUNT ? (ChangeKind)g_rand_int_range(rng, 0, CHANGE_KIND_COUNT) : kind);
+        wait_for_commit();
+    }
+    Traffic after = get_traffic();
+
+    BENCHMARK_RESULT(
+        (after.requests - before.requests) / (double)changes - settle_requests, "per-change",
+        "churn-requests/%s", name);
+    BENCHMARK_RESULT((after.commits - before.commits) / (double)changes, "per-change", "churn-commits/%s", name);
+    BENCHMARK_RESULT((after.attaches - before.attaches) / (double)changes, "per-change", "churn-attaches/%s", name);
+    // Changes that don't affect the content (such as margin or layer) should ideally not upload anything
+    BENCHMARK_RESULT(
+        (after.bytes_attached - before.bytes_attached) / (double)changes, "bytes-per-change",
+        "churn-bytes-attached/%s", name);
+    BENCHMARK_RESULT(
+        (after.damage_area - before.damage_area) / (double)changes, "pixels-per-change",
+        "churn-damage-area/%s", name);
+    BENCHMARK_RESULT(
+        (after.unchanged_commits - before.unchanged_commits) / (double)changes, "per-change",
+        "churn-unchanged-commits/%s", name);
+}
+
+static void callback_0()
+{
+    // Fixed seed by default so runs are comparable
+    const char* seed = getenv("GTKLS_BENCHMARK_SEED");
+    rng = g_rand_new_with_seed(seed ? strtoul(seed, NULL, 10) : 1);
+
+    window = create_default_window();
+    gtk_layer_init_for_window(window);
+    gtk_widget_show_all(GTK_WIDGET(window));
+    GdkFrameClock* frame_clock = gdk_window_get_frame_clock(gtk_widget_get_window(GTK_WIDGET(window)));
+    g_signal_connect(frame_clock, "after-paint", G_CALLBACK(on_after_paint), NULL);
+    settle_events();
+
+    const int settle_samples = 10;
+    long requests_before = get_mock_server_stat("requests");
+    for (int i = 0; i < settle_samples; i++) {
+        settle_events();
+    }
+    settle_requests = (get_mock_server_stat("requests") - requests_before) / (double)settle_samples;
+
+    for (ChangeKind kind = 0; kind < CHANGE_KIND_COUNT; kind++) {
+        run(change_kind_names[kind], kind, CHANGES_PER_KIND);
+    }
+    run("mixed", CHANGE_KIND_COUNT, MIXED_CHANGES);
+
+    g_signal_handlers_disconnect_by_func(frame_clock, on_after_paint, NULL);
+    g_rand_free(rng);
+}
+
+TEST_CALLBACKS(
+    callback_0,
+)
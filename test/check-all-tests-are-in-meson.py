@@ -45,6 +45,7 @@ if __name__ == '__main__':
     test_dir = path.dirname(path.realpath(__file__))
     check_dir(path.join(test_dir, 'integration-tests'))
     check_dir(path.join(test_dir, 'unit-tests'))
+    check_dir(path.join(test_dir, 'benchmarks'))
     if dead_tests:
         print('The following tests have not been added to meson:')
         for test in dead_tests:
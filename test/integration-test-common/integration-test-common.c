@@ -10,8 +10,11 @@
  */
 
 #include "integration-test-common.h"
-#include <fcntl.h>
-#include <sys/stat.h>
+#ifdef HAVE_MOCK_SERVER_IN_PROCESS
+#include "mock-server-lib.h"
+#endif
+#include <sys/socket.h>
+#include <sys/un.h>
 
 // Time for each callback to run
 static int step_time = 500;
@@ -22,8 +25,9 @@ static gboolean auto_continue = FALSE;
 static gboolean complete = FALSE;
 struct wl_display* wl_display = NULL;
 
-char command_fifo_path[255] = {0};
-char response_fifo_path[255] = {0};
+char command_socket_path[255] = {0};
+static int command_fd = -1; // Connected on the first command and kept open
+static GString* command_responses = NULL; // Received but not yet returned responses
 static void init_paths() {
     const char* test_dir = getenv("GTKLS_TEST_DIR");
     if (test_dir) {
@@ -38,45 +42,144 @@ static void init_paths() {
         FATAL_FMT("GTKLS_TEST_DIR or XDG_RUNTIME_DIR must be set");
     }
     ASSERT(strlen(test_dir) < 200);
-    sprintf(command_fifo_path, "%s/gtkls-test-command", test_dir);
-    sprintf(response_fifo_path, "%s/gtkls-test-response", test_dir);
+    sprintf(command_socket_path, "%s/gtkls-test-command", test_dir);
 }
 
-void send_command(const char* command, const char* expected_response) {
-    fprintf(stderr, "sending command: %s\n", command);
+static void connect_command_socket() {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    ASSERT(strlen(command_socket_path));
+    ASSERT(strlen(command_socket_path) < sizeof(addr.sun_path));
+    strcpy(addr.sun_path, command_socket_path);
+    ASSERT((command_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) >= 0);
+    ASSERT(connect(command_fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    command_responses = g_string_new(NULL);
+}
 
-    ASSERT(strlen(response_fifo_path));
-    int response_fd;
-    mkfifo(response_fifo_path, 0666);
-
-    ASSERT(strlen(command_fifo_path));
-    int command_fd;
-    ASSERT((command_fd = open(command_fifo_path, O_WRONLY)) >= 0);
-    ASSERT(write(command_fd, command, strlen(command)) > 0);
-    ASSERT(write(command_fd, "\n", 1) > 0);
-    close(command_fd);
-
-    fprintf(stderr, "awaiting response: %s\n", expected_response);
-    ASSERT((response_fd = open(response_fifo_path, O_RDONLY)) >= 0);
-#define BUFFER_SIZE 1024
-    char buffer[BUFFER_SIZE];
-    int length = 0;
-    while (TRUE) {
-        ASSERT(length < BUFFER_SIZE);
-        char* c = buffer + length;
-        ssize_t bytes_read = read(response_fd, c, 1);
+static void write_commands(const char* data, size_t length) {
+    if (command_fd < 0) {
+        connect_command_socket();
+    }
+    while (length) {
+        ssize_t written = write(command_fd, data, length);
+        ASSERT(written > 0);
+        data += written;
+        length -= written;
+    }
+}
+
+// Returns the next response line, which must be freed with g_free()
+static char* read_response() {
+    char* newline;
+    while (!(newline = memchr(command_responses->str, '\n', command_responses->len))) {
+        char chunk[1024];
+        ssize_t bytes_read = read(command_fd, chunk, sizeof(chunk));
         ASSERT(bytes_read > 0);
-        if (*c == '\n') {
-            *c = '\0';
-            fprintf(stderr, "got: %s\n", buffer);
-            ASSERT_STR_EQ(buffer, expected_response);
-            break;
-        } else {
-            length++;
-        }
+        g_string_append_len(command_responses, chunk, bytes_read);
+    }
+    size_t length = newline - command_responses->str;
+    char* response = g_strndup(command_responses->str, length);
+    g_string_erase(command_responses, 0, length + 1);
+    fprintf(stderr, "got: %s\n", response);
+    return response;
+}
+
+char* query_command(const char* command) {
+    fprintf(stderr, "sending command: %s\n", command);
+    char* line = g_strconcat(command, "\n", NULL);
+    write_commands(line, strlen(line));
+    g_free(line);
+    return read_response();
+}
+
+void send_command(const char* command, const char* expected_response) {
+    fprintf(stderr, "expecting response: %s\n", expected_response);
+    char* response = query_command(command);
+    ASSERT_STR_EQ(response, expected_response);
+    g_free(response);
+}
+
+void send_command_batch(const char** commands, const char** expected_responses, int count) {
+    // All commands go out in one write, so the server runs them in a single turn of its event loop
+    GString* batch = g_string_new(NULL);
+    for (int i = 0; i < count; i++) {
+        fprintf(stderr, "sending command: %s\n", commands[i]);
+        g_string_append(batch, commands[i]);
+        g_string_append_c(batch, '\n');
+    }
+    write_commands(batch->str, batch->len);
+    g_string_free(batch, TRUE);
+    for (int i = 0; i < count; i++) {
+        char* response = read_response();
+        ASSERT_STR_EQ(response, expected_responses[i]);
+        g_free(response);
+    }
+}
+
+long get_mock_server_stat(const char* name) {
+    char* response = query_command("get_stats");
+    char* key = g_strdup_printf(" %s=", name);
+    char* found = strstr(response, key);
+    if (!found) {
+        FATAL_FMT("mock server stats \"%s\" do not include %s", response, name);
     }
-    close(response_fd);
-#undef BUFFER_SIZE
+    long value = strtol(found + strlen(key), NULL, 10);
+    g_free(key);
+    g_free(response);
+    return value;
+}
+
+int get_benchmark_surface_count() {
+    const char* env = getenv("GTKLS_BENCHMARK_SURFACES");
+    if (!env) {
+        return 1;
+    }
+    int count = atoi(env);
+    if (count < 1) {
+        FATAL_FMT("invalid GTKLS_BENCHMARK_SURFACES \"%s\"", env);
+    }
+    return count;
+}
+
+void run_benchmark_for_each_surface_count(void (*run)(int count)) {
+    int counts[] = BENCHMARK_SURFACE_COUNTS;
+    for (size_t i = 0; i < G_N_ELEMENTS(counts); i++) {
+        run(counts[i]);
+    }
+}
+
+GtkWindow** create_benchmark_windows(int count) {
+    GtkWindow** windows = g_new0(GtkWindow*, count + 1);
+    for (int i = 0; i < count; i++) {
+        windows[i] = create_default_window();
+        gtk_layer_init_for_window(windows[i]);
+        gtk_widget_show_all(GTK_WIDGET(windows[i]));
+    }
+    settle_events();
+    return windows;
+}
+
+GtkWindow* create_benchmark_popup(GtkWindow* parent) {
+    GtkWindow* popup = GTK_WINDOW(gtk_window_new(GTK_WINDOW_POPUP));
+    gtk_window_set_type_hint(popup, GDK_WINDOW_TYPE_HINT_POPUP_MENU);
+    gtk_window_set_transient_for(popup, parent);
+    gtk_widget_set_size_request(GTK_WIDGET(popup), 100, 100);
+    gtk_widget_realize(GTK_WIDGET(popup));
+    GdkRectangle anchor_rect = {0, 0, 10, 10};
+    gdk_window_move_to_rect(
+        gtk_widget_get_window(GTK_WIDGET(popup)),
+        &anchor_rect,
+        GDK_GRAVITY_SOUTH,
+        GDK_GRAVITY_NORTH,
+        0, 0, 0);
+    return popup;
+}
+
+void destroy_benchmark_windows(GtkWindow** windows) {
+    for (GtkWindow** window = windows; *window; window++) {
+        gtk_widget_destroy(GTK_WIDGET(*window));
+    }
+    g_free(windows);
+    settle_events();
 }
 
 static gboolean next_step(gpointer _data) {
@@ -124,6 +227,14 @@ GtkWindow* create_default_window()
     return window;
 }
 
+void settle_events()
+{
+    do {
+        while (g_main_context_iteration(NULL, FALSE)) {}
+        wl_display_roundtrip(wl_display);
+    } while (g_main_context_pending(NULL));
+}
+
 static void continue_button_callback(GtkWidget *_widget, gpointer _data)
 {
     (void)_widget; (void)_data;
@@ -152,6 +263,20 @@ int main(int argc, char** argv) {
     setenv("GSK_RENDERER", "cairo", FALSE);
 
     init_paths();
+    if (g_strcmp0(getenv("GTKLS_MOCK_IN_PROCESS"), "1") == 0) {
+#ifdef HAVE_MOCK_SERVER_IN_PROCESS
+        // Run the mock server on a thread in this process instead of connecting to a separate one
+        int wayland_fd;
+        mock_server_start_in_process(&wayland_fd, &command_fd);
+        command_responses = g_string_new(NULL);
+        char wayland_socket[16];
+        sprintf(wayland_socket, "%d", wayland_fd);
+        // Takes priority over WAYLAND_DISPLAY when GDK connects
+        setenv("WAYLAND_SOCKET", wayland_socket, TRUE);
+#else
+        FATAL("only benchmarks can run the mock server in-process");
+#endif
+    }
     gtk_init(0, NULL);
     wl_display = gdk_wayland_display_get_wl_display(gdk_display_get_default());
     ASSERT(wl_display);
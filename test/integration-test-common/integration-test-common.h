@@ -23,6 +23,11 @@
 #define EXPECT_MESSAGE(message) fprintf(stderr, "EXPECT: %s\n", #message)
 // Tell the test script this request is not expected
 #define UNEXPECT_MESSAGE(message) fprintf(stderr, "UNEXPECT: %s\n", #message)
+// Tell the test script that no more than count messages containing the given components should be sent before the
+// end of this callback
+#define EXPECT_AT_MOST(count, message) fprintf(stderr, "EXPECT_AT_MOST: %d %s\n", (int)(count), #message)
+// Tell the test script that no more than count surface commits should be made before the end of this callback
+#define EXPECT_COMMITS_AT_MOST(count) EXPECT_AT_MOST(count, wl_surface .commit)
 // Tell the test script that all expected messages should now be fulfilled
 // (called automatically before each callback and at the end of the test)
 #define CHECK_EXPECTATIONS() fprintf(stderr, "CHECK EXPECTATIONS COMPLETED\n")
@@ -34,9 +39,44 @@ extern void (* test_callbacks[])(void);
 // Input is a sequence of callback names with a trailing comma
 #define TEST_CALLBACKS(...) void (* test_callbacks[])(void) = {__VA_ARGS__ NULL};
 
+// Report a benchmark result, collected by run-integration-test.py --benchmark. The name is a printf format (which must
+// be a string literal without spaces) for the remaining arguments.
+#define BENCHMARK_RESULT(value, unit, name_format, ...) \
+    fprintf(stderr, "BENCHMARK: " name_format " %f %s\n", ##__VA_ARGS__, (double)(value), unit)
+// The number of simultaneous surfaces each benchmark should be run with
+#define BENCHMARK_SURFACE_COUNTS {1, 10, 100}
+
+// The surface count run-integration-test.py --massif passes in GTKLS_BENCHMARK_SURFACES (1 if unset)
+int get_benchmark_surface_count();
+
+// Calls run once with each of BENCHMARK_SURFACE_COUNTS
+void run_benchmark_for_each_surface_count(void (*run)(int count));
+
+// Creates and shows count default layer surfaces, and settles events so they are all configured and drawn. Returns a
+// NULL-terminated array, to be passed to destroy_benchmark_windows().
+GtkWindow** create_benchmark_windows(int count);
+
+// Creates a popup menu on parent, realized and positioned but not yet shown
+GtkWindow* create_benchmark_popup(GtkWindow* parent);
+
+// Destroys each window in a NULL-terminated array, frees the array and settles events
+void destroy_benchmark_windows(GtkWindow** windows);
+
 // Send a command to the mock server and verify the response is correct
 void send_command(const char* command, const char* expected_response);
 
+// Send a number of commands to the mock server at once, then verify each response is correct
+void send_command_batch(const char** commands, const char** expected_responses, int count);
+
+// Send a command to the mock server and return its response, which must be freed with g_free()
+char* query_command(const char* command);
+
+// Returns the named counter from the mock server's get_stats command (such as "requests")
+long get_mock_server_stat(const char* name);
+
 GtkWindow* create_default_window();
 
+// Dispatch everything that is currently pending and roundtrip with the compositor until nothing new comes in
+void settle_events();
+
 #endif // TEST_CLIENT_COMMON_H
@@ -0,0 +1,117 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "integration-test-common.h"
+
+static GtkWindow* window;
+static int released_count = 0;
+
+static void on_release(gpointer user_data)
+{
+    ASSERT_EQ(GPOINTER_TO_INT(user_data), released_count + 1, "%d");
+    released_count++;
+}
+
+// Attaches a buffer of 4x4 pixels, the fd is closed right away
+static void attach_buffer(int id)
+{
+    int fd = g_file_open_tmp(NULL, NULL, NULL);
+    ASSERT(fd >= 0);
+    ASSERT(ftruncate(fd, 4 * 4 * 4) == 0);
+    ASSERT(gtk_layer_attach_buffer(window, fd, 4 * 4, 0, 4, 4, on_release, GINT_TO_POINTER(id)));
+    close(fd);
+}
+
+static void callback_0()
+{
+    EXPECT_MESSAGE(wl_shm_pool .create_buffer 0 4 4 16 0);
+    EXPECT_MESSAGE(wp_viewport .set_destination 600 700);
+    EXPECT_MESSAGE(wl_surface .attach wl_buffer);
+    EXPECT_MESSAGE(wl_surface .commit);
+
+    window = create_default_window();
+    gtk_layer_init_for_window(window);
+    gtk_widget_set_size_request(GTK_WIDGET(window), 600, 700);
+    attach_buffer(1);
+    gtk_widget_show_all(GTK_WIDGET(window));
+}
+
+static void callback_1()
+{
+    // The compositor is done with the first buffer, but it's still the one shown
+    ASSERT_EQ(released_count, 0, "%d");
+
+    EXPECT_MESSAGE(zwlr_layer_surface_v1 .set_margin 10 0 0 0);
+    EXPECT_MESSAGE(wl_surface .commit);
+    UNEXPECT_MESSAGE(wl_shm_pool .create_buffer);
+
+    gtk_layer_set_margin(window, GTK_LAYER_SHELL_EDGE_TOP, 10);
+}
+
+static void callback_2()
+{
+    EXPECT_MESSAGE(wl_shm_pool .create_buffer 0 4 4 16 0);
+    EXPECT_MESSAGE(wl_surface .attach wl_buffer);
+    EXPECT_MESSAGE(wl_surface .commit);
+
+    attach_buffer(2);
+    // Already released by the compositor, so it's freed right away
+    ASSERT_EQ(released_count, 1, "%d");
+}
+
+static void callback_3()
+{
+    // GDK is frozen while the buffer is attached, so the region has to go out with our own commit
+    EXPECT_MESSAGE(wl_region .add 0 0 4 4);
+    EXPECT_MESSAGE(wl_surface .set_opaque_region wl_region);
+    EXPECT_MESSAGE(wl_surface .commit);
+    UNEXPECT_MESSAGE(wl_shm_pool .create_buffer);
+
+    cairo_rectangle_int_t rect = {0, 0, 4, 4};
+    cairo_region_t* region = cairo_region_create_rectangle(&rect);
+    gtk_layer_set_opaque_region(window, region);
+    cairo_region_destroy(region);
+}
+
+static void callback_4()
+{
+    // GTK takes over drawing again
+    EXPECT_MESSAGE(wl_shm_pool .create_buffer);
+    EXPECT_MESSAGE(wl_surface .commit);
+
+    gtk_layer_detach_buffer(window);
+}
+
+static void callback_5()
+{
+    ASSERT_EQ(released_count, 2, "%d");
+
+    // Rows shorter than the width are rejected, and so are formats the compositor did not advertise
+    EXPECT_MESSAGE(WARNING Can not attach invalid buffer);
+    EXPECT_MESSAGE(WARNING Compositor does not support buffer format);
+    UNEXPECT_MESSAGE(wl_shm_pool .create_buffer);
+
+    int fd = g_file_open_tmp(NULL, NULL, NULL);
+    ASSERT(fd >= 0);
+    ASSERT(ftruncate(fd, 4 * 4 * 4) == 0);
+    ASSERT(!gtk_layer_attach_buffer(window, fd, 4 * 3, WL_SHM_FORMAT_ARGB8888, 4, 4, on_release, NULL));
+    ASSERT(!gtk_layer_attach_buffer(window, fd, 4 * 2, WL_SHM_FORMAT_RGB565, 4, 4, on_release, NULL));
+    close(fd);
+}
+
+TEST_CALLBACKS(
+    callback_0,
+    callback_1,
+    callback_2,
+    callback_3,
+    callback_4,
+    callback_5,
+)
@@ -0,0 +1,48 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "integration-test-common.h"
+
+static GtkWindow* window;
+
+static void callback_0()
+{
+    EXPECT_MESSAGE(wp_fractional_scale_manager_v1 .get_fractional_scale);
+    EXPECT_MESSAGE(wp_fractional_scale_v1 .preferred_scale 120);
+    EXPECT_MESSAGE(wp_viewport .set_destination 600 700);
+
+    window = create_default_window();
+    gtk_layer_init_for_window(window);
+    gtk_widget_set_size_request(GTK_WIDGET(window), 600, 700);
+    gtk_widget_show_all(GTK_WIDGET(window));
+}
+
+static void callback_1()
+{
+    EXPECT_MESSAGE(wp_fractional_scale_v1 .preferred_scale 180);
+
+    ASSERT_EQ(gtk_layer_get_preferred_scale(window), 1.0, "%f");
+    send_command("set_preferred_scale 1.5", "preferred_scale_set");
+}
+
+static void callback_2()
+{
+    // The logical size should not change with the scale
+    UNEXPECT_MESSAGE(wp_viewport .set_destination);
+
+    ASSERT_EQ(gtk_layer_get_preferred_scale(window), 1.5, "%f");
+}
+
+TEST_CALLBACKS(
+    callback_0,
+    callback_1,
+    callback_2,
+)
@@ -0,0 +1,62 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "integration-test-common.h"
+
+static GtkWindow* window;
+static int scale_notify_count = 0;
+
+static void on_scale_factor_notify(GObject* object, GParamSpec* pspec, gpointer user_data)
+{
+    (void)object;
+    (void)pspec;
+    (void)user_data;
+    scale_notify_count++;
+}
+
+static void callback_0()
+{
+    // Monitor 0 (the one GDK would guess) stays at scale 1
+    send_command("create_output 1920 1080", "output_created");
+    send_command("set_output_scale 1 2", "output_scale_set");
+}
+
+static void callback_1()
+{
+    EXPECT_MESSAGE(wl_surface .set_buffer_scale 2);
+    EXPECT_MESSAGE(wl_shm_pool .create_buffer 1200 1400);
+    // Rendering a buffer at scale 1 first would be a wasted frame
+    UNEXPECT_MESSAGE(wl_shm_pool .create_buffer 600 700);
+
+    GdkMonitor* monitor = gdk_display_get_monitor(gdk_display_get_default(), 1);
+    ASSERT(monitor);
+    ASSERT_EQ(gdk_monitor_get_scale_factor(monitor), 2, "%d");
+
+    window = create_default_window();
+    g_signal_connect(window, "notify::scale-factor", G_CALLBACK(on_scale_factor_notify), NULL);
+    gtk_layer_init_for_window(window);
+    gtk_layer_set_monitor(window, monitor);
+    gtk_widget_set_size_request(GTK_WIDGET(window), 600, 700);
+    gtk_widget_show_all(GTK_WIDGET(window));
+}
+
+static void callback_2()
+{
+    // GTK knows about the scale, even though GDK never saw it change
+    ASSERT_EQ(gtk_widget_get_scale_factor(GTK_WIDGET(window)), 2, "%d");
+    ASSERT(scale_notify_count > 0);
+}
+
+TEST_CALLBACKS(
+    callback_0,
+    callback_1,
+    callback_2,
+)
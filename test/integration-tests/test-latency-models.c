@@ -0,0 +1,64 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "integration-test-common.h"
+
+static GtkWindow* window;
+
+static void callback_0()
+{
+    // Seeded so every run gets the same latencies
+    send_command("set_latency_seed 3", "latency_seed_set");
+    send_command("set_latency configure longtail 20 200", "latency_set");
+    send_command("set_latency frame uniform 1 30", "latency_set");
+    send_command("set_latency release fixed 10", "latency_set");
+}
+
+static void callback_1()
+{
+    EXPECT_MESSAGE(zwlr_layer_surface_v1 .configure);
+    EXPECT_MESSAGE(zwlr_layer_surface_v1 .ack_configure);
+    EXPECT_MESSAGE(wl_surface .commit);
+    EXPECT_MESSAGE(wl_buffer .release);
+
+    window = create_default_window();
+    gtk_layer_init_for_window(window);
+    gtk_widget_show_all(GTK_WIDGET(window));
+}
+
+static void callback_2()
+{
+    EXPECT_MESSAGE(zwlr_layer_surface_v1 .set_margin 0 0 0 20);
+    EXPECT_MESSAGE(zwlr_layer_surface_v1 .configure);
+    EXPECT_MESSAGE(zwlr_layer_surface_v1 .ack_configure);
+
+    gtk_layer_set_margin(window, GTK_LAYER_SHELL_EDGE_LEFT, 20);
+}
+
+static void callback_3()
+{
+    // No event is sent before its latency is up
+    ASSERT(get_mock_server_stat("release_delays") > 0);
+    ASSERT(get_mock_server_stat("release_delay_min_us") >= 10000);
+    ASSERT(get_mock_server_stat("frame_delays") > 0);
+    ASSERT(get_mock_server_stat("frame_delay_min_us") >= 1000);
+    // The initial configure and the one for the margin
+    ASSERT(get_mock_server_stat("configure_delays") >= 2);
+    ASSERT(get_mock_server_stat("configure_delay_min_us") >= 1000);
+}
+
+TEST_CALLBACKS(
+    callback_0,
+    callback_1,
+    callback_2,
+    callback_3,
+)
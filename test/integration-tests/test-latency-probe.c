@@ -0,0 +1,53 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "integration-test-common.h"
+
+static GtkWindow* window;
+
+static void callback_0()
+{
+    // Must be set before the library initializes, which happens in gtk_layer_init_for_window()
+    g_setenv("GTK_LAYER_SHELL_LATENCY_PROBE", "1", TRUE);
+    window = create_default_window();
+    gtk_layer_init_for_window(window);
+    gtk_widget_show_all(GTK_WIDGET(window));
+    ASSERT_EQ(gtk_layer_get_latency_percentile(
+        GTK_LAYER_SHELL_LATENCY_KIND_MARGIN, GTK_LAYER_SHELL_LATENCY_STAGE_COMMIT, 50), (gint64)-1, "%" G_GINT64_FORMAT);
+}
+
+static void callback_1()
+{
+    EXPECT_MESSAGE(zwlr_layer_surface_v1 .set_margin 0 0 0 12);
+    gtk_layer_set_margin(window, GTK_LAYER_SHELL_EDGE_LEFT, 12);
+}
+
+static void callback_2()
+{
+    for (int stage = 0; stage < GTK_LAYER_SHELL_LATENCY_STAGE_ENTRY_NUMBER; stage++) {
+        ASSERT_EQ(gtk_layer_get_latency_sample_count(GTK_LAYER_SHELL_LATENCY_KIND_MARGIN, stage), 1u, "%u");
+        ASSERT(gtk_layer_get_latency_percentile(GTK_LAYER_SHELL_LATENCY_KIND_MARGIN, stage, 50) >= 0);
+    }
+    gint64 commit = gtk_layer_get_latency_percentile(
+        GTK_LAYER_SHELL_LATENCY_KIND_MARGIN, GTK_LAYER_SHELL_LATENCY_STAGE_COMMIT, 99);
+    gint64 configure = gtk_layer_get_latency_percentile(
+        GTK_LAYER_SHELL_LATENCY_KIND_MARGIN, GTK_LAYER_SHELL_LATENCY_STAGE_CONFIGURE, 99);
+    ASSERT(configure >= commit);
+    ASSERT_EQ(gtk_layer_get_latency_sample_count(
+        GTK_LAYER_SHELL_LATENCY_KIND_ANCHOR, GTK_LAYER_SHELL_LATENCY_STAGE_COMMIT), 0u, "%u");
+}
+
+TEST_CALLBACKS(
+    callback_0,
+    callback_1,
+    callback_2,
+)
@@ -0,0 +1,131 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "integration-test-common.h"
+
+// The cap used throughout, which lets a frame through every second. Callbacks are run half a second apart, so anything
+// that depends on a frame being held back is checked within the callback that made the change.
+#define MAX_FRAME_RATE 1
+#define FRAME_INTERVAL_US (G_USEC_PER_SEC / MAX_FRAME_RATE)
+// How long to give a frame the cap should hold back to be drawn anyway
+#define DRAW_WAIT_MS 50
+
+static GtkWindow* window;
+static GtkWidget* label;
+static gint64 frame_requested_time; // When the last frame the cap lets through was asked for, so no later than it
+
+static gboolean on_timeout(gpointer data)
+{
+    *(gboolean*)data = TRUE;
+    return G_SOURCE_REMOVE;
+}
+
+// Gives GDK long enough to draw anything it is allowed to
+static void wait_for_draw()
+{
+    gboolean timed_out = FALSE;
+    g_timeout_add(DRAW_WAIT_MS, on_timeout, &timed_out);
+    while (!timed_out) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    settle_events();
+}
+
+// If the cap is still holding frames back. Once the interval has passed a frame is allowed, so on a machine too slow to
+// get here in time a held back frame can't be told apart from one drawn in spite of the cap, and the check is skipped.
+static gboolean within_frame_interval()
+{
+    return g_get_monotonic_time() - frame_requested_time < FRAME_INTERVAL_US;
+}
+
+// Checks the change just made was not drawn
+static void assert_held_back(long attaches_before)
+{
+    wait_for_draw();
+    if (within_frame_interval()) {
+        ASSERT_EQ(get_mock_server_stat("attaches"), attaches_before, "%ld");
+    }
+}
+
+static void callback_0()
+{
+    EXPECT_MESSAGE(wl_shm_pool .create_buffer);
+    EXPECT_MESSAGE(wl_surface .commit);
+
+    window = create_default_window();
+    label = gtk_bin_get_child(GTK_BIN(window));
+    gtk_layer_init_for_window(window);
+    gtk_layer_set_max_frame_rate(window, MAX_FRAME_RATE);
+    gtk_widget_set_size_request(GTK_WIDGET(window), 600, 700);
+    frame_requested_time = g_get_monotonic_time();
+    gtk_widget_show_all(GTK_WIDGET(window));
+    ASSERT_EQ(gtk_layer_get_max_frame_rate(window), MAX_FRAME_RATE, "%u");
+}
+
+static void callback_1()
+{
+    // A property change is committed without drawing, and so is a region change (which GDK would only send when it
+    // draws)
+    EXPECT_MESSAGE(zwlr_layer_surface_v1 .set_exclusive_zone 5);
+    EXPECT_MESSAGE(wl_surface .commit);
+    EXPECT_MESSAGE(wl_surface .set_input_region wl_region);
+    EXPECT_MESSAGE(wl_surface .commit);
+
+    // Redraws are held back
+    long attaches = get_mock_server_stat("attaches");
+    guint skipped = gtk_layer_get_skipped_frame_count(window);
+    gtk_label_set_text(GTK_LABEL(label), "Changed");
+    gtk_widget_queue_draw(label);
+    gtk_widget_queue_draw(label);
+    if (within_frame_interval()) {
+        // Both redraws fall in the same refresh interval (unless the test is very unlucky with timing)
+        ASSERT(gtk_layer_get_skipped_frame_count(window) > skipped);
+    }
+    assert_held_back(attaches);
+
+    gtk_layer_set_exclusive_zone(window, 5);
+    assert_held_back(attaches);
+
+    gtk_layer_set_click_through(window, TRUE);
+    assert_held_back(attaches);
+}
+
+static void callback_2()
+{
+    // A resize is drawn at the new size right away, so the new size is never shown with an old buffer
+    EXPECT_MESSAGE(wp_viewport .set_destination 800 700);
+    EXPECT_MESSAGE(wl_shm_pool .create_buffer 800 700);
+
+    frame_requested_time = g_get_monotonic_time();
+    gtk_widget_set_size_request(GTK_WIDGET(window), 800, 700);
+    wait_for_draw();
+
+    // The cap holds redraws back again after the resize
+    long attaches = get_mock_server_stat("attaches");
+    gtk_label_set_text(GTK_LABEL(label), "Changed again");
+    gtk_widget_queue_draw(label);
+    assert_held_back(attaches);
+
+    // Removing the cap draws what was held back, once
+    gboolean held_back = within_frame_interval();
+    gtk_layer_set_max_frame_rate(window, 0);
+    wait_for_draw();
+    if (held_back) {
+        ASSERT_EQ(get_mock_server_stat("attaches"), attaches + 1, "%ld");
+    }
+}
+
+TEST_CALLBACKS(
+    callback_0,
+    callback_1,
+    callback_2,
+)
@@ -0,0 +1,55 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "integration-test-common.h"
+
+static GtkWindow* window;
+
+static void callback_0()
+{
+    EXPECT_MESSAGE(wl_region .add 0 0 600 700);
+    EXPECT_MESSAGE(wl_surface .set_opaque_region wl_region);
+
+    window = create_default_window();
+    gtk_layer_init_for_window(window);
+    gtk_widget_set_size_request(GTK_WIDGET(window), 600, 700);
+    gtk_layer_set_auto_opaque_region(window, TRUE);
+    gtk_widget_show_all(GTK_WIDGET(window));
+    ASSERT(gtk_layer_get_auto_opaque_region(window));
+}
+
+static void callback_1()
+{
+    EXPECT_MESSAGE(wl_region .add 10 20 100 50);
+    EXPECT_MESSAGE(wl_surface .set_opaque_region wl_region);
+
+    cairo_rectangle_int_t rect = {10, 20, 100, 50};
+    cairo_region_t* region = cairo_region_create_rectangle(&rect);
+    gtk_layer_set_opaque_region(window, region);
+    cairo_region_destroy(region);
+    ASSERT(!gtk_layer_get_auto_opaque_region(window));
+}
+
+static void callback_2()
+{
+    // The region should follow the size without any more calls
+    EXPECT_MESSAGE(wl_region .add 0 0 800 700);
+    EXPECT_MESSAGE(wl_surface .set_opaque_region wl_region);
+
+    gtk_layer_set_auto_opaque_region(window, TRUE);
+    gtk_widget_set_size_request(GTK_WIDGET(window), 800, 700);
+}
+
+TEST_CALLBACKS(
+    callback_0,
+    callback_1,
+    callback_2,
+)
@@ -0,0 +1,97 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "integration-test-common.h"
+
+static GtkWindow* window;
+static int presented_count = 0;
+static gint64 last_latency = -1;
+static gint64 last_refresh_interval = -1;
+
+static void on_presented(GtkWindow* presented_window, gint64 latency, gint64 refresh_interval, guint missed_frames,
+                         gpointer user_data)
+{
+    ASSERT(presented_window == window);
+    ASSERT_EQ(GPOINTER_TO_INT(user_data), 7, "%d");
+    // The mock server presents on commit
+    ASSERT_EQ(missed_frames, 0u, "%u");
+    presented_count++;
+    last_latency = latency;
+    last_refresh_interval = refresh_interval;
+}
+
+static void callback_0()
+{
+    EXPECT_MESSAGE(wp_presentation .feedback);
+    EXPECT_MESSAGE(wl_surface .commit);
+
+    window = create_default_window();
+    gtk_layer_init_for_window(window);
+    gtk_layer_set_presentation_callback(window, on_presented, GINT_TO_POINTER(7));
+    gtk_widget_show_all(GTK_WIDGET(window));
+}
+
+static void callback_1()
+{
+    ASSERT(presented_count > 0);
+    ASSERT(last_latency >= 0);
+    ASSERT_EQ(last_refresh_interval, (gint64)16666, "%" G_GINT64_FORMAT);
+
+    // Commits without a new frame get feedback too
+    EXPECT_MESSAGE(wp_presentation .feedback);
+    EXPECT_MESSAGE(zwlr_layer_surface_v1 .set_exclusive_zone 4);
+    EXPECT_MESSAGE(wl_surface .commit);
+
+    presented_count = 0;
+    gtk_layer_set_exclusive_zone(window, 4);
+}
+
+static void callback_2()
+{
+    ASSERT(presented_count > 0);
+
+    // Output 0 stays at the default 60Hz
+    send_command("create_output 1920 1080", "output_created");
+    send_command("set_refresh_rate 1 144", "refresh_rate_set");
+}
+
+static void callback_3()
+{
+    EXPECT_MESSAGE(zwlr_layer_shell_v1 .get_layer_surface);
+    EXPECT_MESSAGE(wp_presentation .feedback);
+
+    GdkMonitor* monitor = gdk_display_get_monitor(gdk_display_get_default(), 1);
+    ASSERT(monitor);
+    presented_count = 0;
+    gtk_layer_set_monitor(window, monitor);
+}
+
+static void callback_4()
+{
+    // Feedback reports the refresh interval of the output the surface is on
+    ASSERT(presented_count > 0);
+    ASSERT_EQ(last_refresh_interval, (gint64)6944, "%" G_GINT64_FORMAT);
+
+    UNEXPECT_MESSAGE(wp_presentation .feedback);
+    EXPECT_MESSAGE(zwlr_layer_surface_v1 .set_exclusive_zone 8);
+    EXPECT_MESSAGE(wl_surface .commit);
+
+    gtk_layer_set_presentation_callback(window, NULL, NULL);
+    gtk_layer_set_exclusive_zone(window, 8);
+}
+
+TEST_CALLBACKS(
+    callback_0,
+    callback_1,
+    callback_2,
+    callback_3,
+    callback_4,
+)
@@ -0,0 +1,66 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "integration-test-common.h"
+
+static GtkWindow* window;
+
+static void callback_0()
+{
+    EXPECT_MESSAGE(wp_viewport .set_destination 600 700);
+    // Channels are premultiplied
+    EXPECT_MESSAGE(wp_single_pixel_buffer_manager_v1 .create_u32_rgba_buffer 2147483647 0 0 2147483647);
+    EXPECT_MESSAGE(wl_surface .attach wl_buffer);
+    EXPECT_MESSAGE(wl_surface .commit);
+    UNEXPECT_MESSAGE(wl_shm_pool .create_buffer);
+
+    window = create_default_window();
+    gtk_layer_init_for_window(window);
+    gtk_widget_set_size_request(GTK_WIDGET(window), 600, 700);
+    GdkRGBA color = {1, 0, 0, 0.5};
+    gtk_layer_set_solid_color(window, &color);
+    gtk_widget_show_all(GTK_WIDGET(window));
+}
+
+static void callback_1()
+{
+    EXPECT_MESSAGE(zwlr_layer_surface_v1 .set_margin 10 0 0 0);
+    EXPECT_MESSAGE(wl_surface .commit);
+    UNEXPECT_MESSAGE(wl_shm_pool .create_buffer);
+
+    gtk_layer_set_margin(window, GTK_LAYER_SHELL_EDGE_TOP, 10);
+}
+
+static void callback_2()
+{
+    // GDK never paints a solid color surface, so the input region has to go out with our own commit
+    EXPECT_MESSAGE(wl_surface .set_input_region wl_region);
+    EXPECT_MESSAGE(wl_surface .commit);
+    UNEXPECT_MESSAGE(wl_shm_pool .create_buffer);
+
+    gtk_layer_set_click_through(window, TRUE);
+}
+
+static void callback_3()
+{
+    // GTK takes over drawing again
+    EXPECT_MESSAGE(wl_shm_pool .create_buffer);
+    EXPECT_MESSAGE(wl_surface .commit);
+
+    gtk_layer_set_solid_color(window, NULL);
+}
+
+TEST_CALLBACKS(
+    callback_0,
+    callback_1,
+    callback_2,
+    callback_3,
+)
@@ -0,0 +1,85 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "integration-test-common.h"
+
+static GtkWindow* window;
+static GtkWidget* label;
+
+static void callback_0()
+{
+    EXPECT_MESSAGE(wl_shm_pool .create_buffer);
+    EXPECT_MESSAGE(wl_surface .commit);
+
+    window = create_default_window();
+    label = gtk_bin_get_child(GTK_BIN(window));
+    gtk_layer_init_for_window(window);
+    gtk_layer_set_layer(window, GTK_LAYER_SHELL_LAYER_BACKGROUND);
+    gtk_layer_set_static_content(window, TRUE);
+    gtk_widget_set_size_request(GTK_WIDGET(window), 600, 700);
+    gtk_widget_show_all(GTK_WIDGET(window));
+    ASSERT(gtk_layer_get_static_content(window));
+}
+
+static void callback_1()
+{
+    // Redraws are ignored
+    UNEXPECT_MESSAGE(wl_surface .attach);
+
+    gtk_label_set_text(GTK_LABEL(label), "Changed");
+    gtk_widget_queue_draw(label);
+}
+
+static void callback_2()
+{
+    // A property change is committed without repainting
+    UNEXPECT_MESSAGE(wl_surface .attach);
+    EXPECT_MESSAGE(zwlr_layer_surface_v1 .set_exclusive_zone 5);
+    EXPECT_MESSAGE(wl_surface .commit);
+
+    gtk_layer_set_exclusive_zone(window, 5);
+}
+
+static void callback_3()
+{
+    // So is a region change, which GDK would only send when it paints
+    UNEXPECT_MESSAGE(wl_surface .attach);
+    EXPECT_MESSAGE(wl_surface .set_input_region wl_region);
+    EXPECT_MESSAGE(wl_surface .commit);
+
+    gtk_layer_set_click_through(window, TRUE);
+}
+
+static void callback_4()
+{
+    EXPECT_MESSAGE(wl_surface .attach wl_buffer);
+    EXPECT_COMMITS_AT_MOST(1);
+
+    gtk_layer_mark_content_dirty(window);
+}
+
+static void callback_5()
+{
+    // A resize renders exactly once
+    EXPECT_MESSAGE(wl_shm_pool .create_buffer 800 700);
+    EXPECT_AT_MOST(1, wl_surface .attach wl_buffer);
+
+    gtk_widget_set_size_request(GTK_WIDGET(window), 800, 700);
+}
+
+TEST_CALLBACKS(
+    callback_0,
+    callback_1,
+    callback_2,
+    callback_3,
+    callback_4,
+    callback_5,
+)
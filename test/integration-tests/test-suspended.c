@@ -0,0 +1,98 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "integration-test-common.h"
+
+static GtkWindow* window;
+static GtkWidget* label;
+static int suspended_count = 0;
+static int resumed_count = 0;
+
+static void on_suspended(GtkWindow* suspended_window, gboolean suspended, gpointer user_data)
+{
+    (void)user_data;
+    ASSERT(suspended_window == window);
+    if (suspended) {
+        suspended_count++;
+    } else {
+        resumed_count++;
+    }
+}
+
+static void callback_0()
+{
+    window = create_default_window();
+    label = gtk_bin_get_child(GTK_BIN(window));
+    gtk_layer_init_for_window(window);
+    gtk_layer_set_suspended_callback(window, on_suspended, NULL);
+    gtk_layer_set_pause_when_suspended(window, TRUE);
+    gtk_widget_show_all(GTK_WIDGET(window));
+    ASSERT(gtk_layer_get_pause_when_suspended(window));
+}
+
+static void callback_1()
+{
+    ASSERT(!gtk_layer_get_suspended(window));
+    ASSERT_EQ(suspended_count, 0, "%d");
+
+    EXPECT_MESSAGE(zwlr_layer_surface_v1 .set_exclusive_zone 3);
+    EXPECT_MESSAGE(wl_surface .frame);
+    EXPECT_MESSAGE(wl_surface .commit);
+
+    send_command("set_output_power 0 off", "output_power_set");
+    gtk_layer_set_exclusive_zone(window, 3);
+}
+
+static void callback_2()
+{
+    // The frame callback never comes, wait for the library to give up on it (which takes a second)
+    while (!gtk_layer_get_suspended(window)) g_main_context_iteration(NULL, TRUE);
+    ASSERT_EQ(suspended_count, 1, "%d");
+
+    // Drawing is paused
+    UNEXPECT_MESSAGE(wl_surface .attach);
+
+    gtk_label_set_text(GTK_LABEL(label), "Changed");
+    gtk_widget_queue_draw(label);
+}
+
+static void callback_3()
+{
+    // A region change is still committed, without drawing
+    UNEXPECT_MESSAGE(wl_surface .attach);
+    EXPECT_MESSAGE(wl_surface .set_input_region wl_region);
+    EXPECT_MESSAGE(wl_surface .commit);
+
+    gtk_layer_set_click_through(window, TRUE);
+}
+
+static void callback_4()
+{
+    // What was invalidated while suspended is drawn once the output is back
+    EXPECT_MESSAGE(wl_surface .attach wl_buffer);
+
+    send_command("set_output_power 0 on", "output_power_set");
+}
+
+static void callback_5()
+{
+    ASSERT(!gtk_layer_get_suspended(window));
+    ASSERT_EQ(resumed_count, 1, "%d");
+}
+
+TEST_CALLBACKS(
+    callback_0,
+    callback_1,
+    callback_2,
+    callback_3,
+    callback_4,
+    callback_5,
+)
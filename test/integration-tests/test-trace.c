@@ -0,0 +1,50 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "integration-test-common.h"
+
+static GtkWindow* window;
+
+static void callback_0()
+{
+    // Must be set before the library initializes, which happens in gtk_layer_init_for_window()
+    g_setenv("GTK_LAYER_SHELL_TRACE", "1", TRUE);
+    window = create_default_window();
+    gtk_layer_init_for_window(window);
+    gtk_layer_set_anchor(window, GTK_LAYER_SHELL_EDGE_TOP, TRUE);
+    gtk_widget_show_all(GTK_WIDGET(window));
+}
+
+static void callback_1()
+{
+    EXPECT_MESSAGE(zwlr_layer_surface_v1 .set_margin 0 0 0 12);
+    gtk_layer_set_margin(window, GTK_LAYER_SHELL_EDGE_LEFT, 12);
+}
+
+static void callback_2()
+{
+    char* trace = gtk_layer_get_trace();
+    ASSERT(trace);
+    ASSERT(strstr(trace, "\"type\":\"map\""));
+    ASSERT(strstr(trace, "\"name\":\"anchor-top\""));
+    ASSERT(strstr(trace, "\"name\":\"zwlr_layer_surface_v1.configure\""));
+    ASSERT(strstr(trace, "\"type\":\"ack\""));
+    ASSERT(strstr(trace, "\"type\":\"commit\""));
+    ASSERT(strstr(trace, "\"name\":\"zwlr_layer_surface_v1.set_margin\",\"args\":[0,0,0,12]"));
+    g_free(trace);
+}
+
+TEST_CALLBACKS(
+    callback_0,
+    callback_1,
+    callback_2,
+)
@@ -0,0 +1,42 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "mock-server.h"
+#include <pthread.h>
+#include <sys/socket.h>
+
+static void* server_thread(void* data) {
+    int result = mock_server_run();
+    if (result != 0) {
+        FATAL_FMT("in-process mock server failed with %d", result);
+    }
+    return NULL;
+}
+
+void mock_server_start_in_process(int* wayland_fd, int* command_fd) {
+    int wayland_fds[2];
+    int command_fds[2];
+    ASSERT(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, wayland_fds) == 0);
+    ASSERT(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, command_fds) == 0);
+
+    // Everything is set up before the thread starts, so nothing here races with the client
+    mock_server_init();
+    ASSERT(wl_client_create(mock_server_display, wayland_fds[0]));
+    mock_server_add_command_connection(command_fds[0]);
+
+    pthread_t thread;
+    ASSERT(pthread_create(&thread, NULL, server_thread, NULL) == 0);
+    pthread_detach(thread);
+
+    *wayland_fd = wayland_fds[1];
+    *command_fd = command_fds[1];
+}
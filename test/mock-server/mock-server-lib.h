@@ -0,0 +1,30 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+// The interface for running the mock server, either as its own process (see mock-server-main.c) or embedded in a test
+// client. This header doesn't include wayland-server.h, so it can be used alongside wayland-client.h.
+
+#pragma once
+
+// Creates the display and sets up the mock compositor on it
+void mock_server_init();
+// Makes the display and command socket available in the test directory
+void mock_server_listen();
+// Serves commands on an already connected socket
+void mock_server_add_command_connection(int fd);
+// Runs until the last client disconnects, returns the process exit code
+int mock_server_run();
+
+// Starts the mock server on its own thread in the calling process, connected to this process over socketpairs
+// instead of a socket in the test directory. Must be called before connecting to Wayland. Sets wayland_fd to the
+// client's end of the Wayland connection (pass it in WAYLAND_SOCKET) and command_fd to a connected command socket.
+void mock_server_start_in_process(int* wayland_fd, int* command_fd);
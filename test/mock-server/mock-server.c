@@ -12,12 +12,12 @@
 #include "mock-server.h"
 
 #include <fcntl.h>
-#include <sys/stat.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <stdbool.h>
 
-struct wl_display* display = NULL;
-
-static void open_command_stream();
+struct wl_display* mock_server_display = NULL;
 
 struct request_override_t {
     const struct wl_message* message;
@@ -25,11 +25,12 @@ struct request_override_t {
     struct wl_list link;
 };
 
-struct wl_list request_overrides;
+static struct wl_list request_overrides;
+
+uint64_t mock_server_request_count = 0;
 
-char wayland_display[255] = {0};
-char command_fifo_path[255] = {0};
-char response_fifo_path[255] = {0};
+static char wayland_display[255] = {0};
+static char command_socket_path[255] = {0};
 static void init_paths() {
     const char* test_dir = getenv("GTKLS_TEST_DIR");
     if (!test_dir) {
@@ -40,8 +41,7 @@ static void init_paths() {
     }
     ASSERT(strlen(test_dir) < 200);
     sprintf(wayland_display, "%s/gtkls-test-display", test_dir);
-    sprintf(command_fifo_path, "%s/gtkls-test-command", test_dir);
-    sprintf(response_fifo_path, "%s/gtkls-test-response", test_dir);
+    sprintf(command_socket_path, "%s/gtkls-test-command", test_dir);
 }
 
 void install_request_override(
@@ -69,6 +69,7 @@ static int default_dispatcher(
     union wl_argument* args
 ) {
     struct wl_resource* created = NULL;
+    mock_server_request_count++;
 
     // If there is a new-id type argument, a resource needs to be created for it
     // See https://wayland.freedesktop.org/docs/html/apb.html#Client-structwl__message
@@ -131,94 +132,197 @@ char type_code_at_index(const struct wl_message* message, int index) {
 static void client_connect(struct wl_listener *listener, void *data) {
     struct wl_client* client = (struct wl_client*)data;
     register_client(client);
+    record_replay_client_connected();
 }
 
 static struct wl_listener client_connect_listener = {
     .notify = client_connect,
 };
 
-static void send_command_response(char* command) {
+// A growable byte buffer
+struct buffer_t {
+    char* data;
+    size_t length;
+    size_t capacity;
+};
+
+static void buffer_append(struct buffer_t* buffer, const char* data, size_t length) {
+    if (buffer->length + length > buffer->capacity) {
+        buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 1024;
+        while (buffer->length + length > buffer->capacity) buffer->capacity *= 2;
+        buffer->data = realloc(buffer->data, buffer->capacity);
+        ASSERT(buffer->data);
+    }
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+}
+
+static void buffer_consume(struct buffer_t* buffer, size_t length) {
+    memmove(buffer->data, buffer->data + length, buffer->length - length);
+    buffer->length -= length;
+}
+
+// A test client connected to the command socket. The connection stays open for the life of the client, and it may
+// send any number of newline-terminated commands without waiting for responses. Each gets one line in response.
+struct command_connection_t {
     int fd;
-    ASSERT((fd = open(response_fifo_path, O_WRONLY)) >= 0);
+    struct wl_event_source* source;
+    struct buffer_t input;
+    struct buffer_t output;
+};
+
+const char* execute_command_line(char* command) {
     const char* argv[20] = {command};
     int argc = 1;
     while (*command) {
         if (*command == ' ') {
             *command = '\0';
+            ASSERT(argc < 19);
             argv[argc] = command + 1;
             argc++;
         }
         command++;
     }
-    const char* response = handle_command(argv);
-    ASSERT(write(fd, response, strlen(response)) > 0);
-    ASSERT(write(fd, "\n", 1) > 0);
-    close(fd);
-}
-
-static int read_command_stream(int fd, uint32_t mask, void *data) {
-#define BUFFER_SIZE 1024
-    static char buffer[BUFFER_SIZE];
-    static int length = 0;
-
-    while (true) {
-        ASSERT(length < BUFFER_SIZE);
-        char* c = buffer + length;
-        ssize_t bytes_read = read(fd, c, 1);
-        if (bytes_read == -1) {
-            return 0;
-        } else if (bytes_read == 0) {
-            close(fd);
-            open_command_stream();
-            return 0;
-        } else if (*c == '\n') {
-            *c = '\0';
-            length = 0;
-            send_command_response(buffer);
-        } else {
-            length++;
+    return handle_command(argv);
+}
+
+static void command_connection_close(struct command_connection_t* connection) {
+    wl_event_source_remove(connection->source);
+    close(connection->fd);
+    free(connection->input.data);
+    free(connection->output.data);
+    free(connection);
+}
+
+// Returns false if the connection was closed
+static bool command_connection_flush(struct command_connection_t* connection) {
+    while (connection->output.length) {
+        ssize_t written = write(connection->fd, connection->output.data, connection->output.length);
+        if (written < 0 && errno == EAGAIN) {
+            // Finish once the client reads some of what's already been sent
+            wl_event_source_fd_update(connection->source, WL_EVENT_READABLE | WL_EVENT_WRITABLE);
+            return true;
+        } else if (written < 0) {
+            command_connection_close(connection);
+            return false;
+        }
+        buffer_consume(&connection->output, written);
+    }
+    wl_event_source_fd_update(connection->source, WL_EVENT_READABLE);
+    return true;
+}
+
+static int command_connection_dispatch(int fd, uint32_t mask, void *data) {
+    struct command_connection_t* connection = data;
+    bool hung_up = mask & (WL_EVENT_HANGUP | WL_EVENT_ERROR);
+
+    if (mask & WL_EVENT_READABLE) {
+        char chunk[4096];
+        while (true) {
+            ssize_t bytes_read = read(fd, chunk, sizeof(chunk));
+            if (bytes_read > 0) {
+                buffer_append(&connection->input, chunk, bytes_read);
+            } else {
+                hung_up |= bytes_read == 0 || errno != EAGAIN;
+                break;
+            }
+        }
+    }
+
+    // Run every complete command that has arrived in this turn of the event loop, and send the responses together
+    size_t start = 0;
+    for (size_t i = 0; i < connection->input.length; i++) {
+        if (connection->input.data[i] == '\n') {
+            connection->input.data[i] = '\0';
+            char* command = connection->input.data + start;
+            const char* response;
+            if (replay_enabled()) {
+                response = replay_client_command(command);
+            } else {
+                char* line = strdup(command);
+                response = execute_command_line(command);
+                record_command(line, response);
+                free(line);
+            }
+            buffer_append(&connection->output, response, strlen(response));
+            buffer_append(&connection->output, "\n", 1);
+            start = i + 1;
         }
     }
+    buffer_consume(&connection->input, start);
 
-#undef BUFFER_SIZE
+    if (!command_connection_flush(connection)) {
+        return 0;
+    }
+    if (hung_up) {
+        command_connection_close(connection);
+    }
+    return 0;
 }
 
-static void open_command_stream() {
-    static struct wl_event_source* event_source = NULL;
-    if (event_source) {
-        wl_event_source_remove(event_source);
+void mock_server_add_command_connection(int fd) {
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    struct command_connection_t* connection = calloc(1, sizeof(struct command_connection_t));
+    connection->fd = fd;
+    connection->source = wl_event_loop_add_fd(
+        wl_display_get_event_loop(mock_server_display),
+        fd,
+        WL_EVENT_READABLE,
+        command_connection_dispatch,
+        connection
+    );
+}
+
+static int command_socket_accept(int fd, uint32_t mask, void *data) {
+    int client_fd = accept(fd, NULL, NULL);
+    if (client_fd >= 0) {
+        mock_server_add_command_connection(client_fd);
     }
+    return 0;
+}
+
+static void open_command_socket() {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    ASSERT(strlen(command_socket_path) < sizeof(addr.sun_path));
+    strcpy(addr.sun_path, command_socket_path);
+    unlink(command_socket_path);
     int fd;
-    mkfifo(command_fifo_path, 0666);
-    ASSERT((fd = open(command_fifo_path, O_RDONLY | O_NONBLOCK)) >= 0);
-    event_source = wl_event_loop_add_fd(
-        wl_display_get_event_loop(display),
+    ASSERT((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) >= 0);
+    ASSERT(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    ASSERT(listen(fd, 8) == 0);
+    wl_event_loop_add_fd(
+        wl_display_get_event_loop(mock_server_display),
         fd,
         WL_EVENT_READABLE,
-        read_command_stream,
+        command_socket_accept,
         NULL
     );
 }
 
-int main(int argc, const char** argv) {
+void mock_server_init() {
     wl_list_init(&request_overrides);
 
     init_paths();
 
-    display = wl_display_create();
-    if (wl_display_add_socket(display, wayland_display) != 0) {
-        FATAL_FMT("server failed to connect to Wayland display %s", wayland_display);
-    }
-
-    open_command_stream();
-
-    wl_display_add_client_created_listener(display, &client_connect_listener);
+    mock_server_display = wl_display_create();
+    wl_display_add_client_created_listener(mock_server_display, &client_connect_listener);
 
     init();
+    record_replay_init();
+}
 
-    fprintf(stderr, "Mock server started\n");
-    wl_display_run(display);
-    wl_display_destroy(display);
+void mock_server_listen() {
+    // Listen for commands before clients can see the Wayland socket, so they can connect as soon as they start
+    open_command_socket();
 
-    return 0;
+    if (wl_display_add_socket(mock_server_display, wayland_display) != 0) {
+        FATAL_FMT("server failed to connect to Wayland display %s", wayland_display);
+    }
+}
+
+int mock_server_run() {
+    wl_display_run(mock_server_display);
+    int result = record_replay_finish();
+    wl_display_destroy(mock_server_display);
+    return result;
 }
@@ -20,14 +20,22 @@
 #pragma once
 
 #include "test-common.h"
+#include "mock-server-lib.h"
 #include <wayland-server.h>
 #include <stdbool.h>
 #include "xdg-shell-server.h"
 #include "xdg-dialog-v1-server.h"
 #include "ext-session-lock-v1-server.h"
 #include "wlr-layer-shell-unstable-v1-server.h"
+#include "viewporter-server.h"
+#include "fractional-scale-v1-server.h"
+#include "single-pixel-buffer-v1-server.h"
+#include "presentation-time-server.h"
 
-extern struct wl_display* display;
+// Prefixed, since benchmarks link the mock server into the same process as the library
+extern struct wl_display* mock_server_display;
+// Number of requests received from all clients, reported by the get_stats command
+extern uint64_t mock_server_request_count;
 
 #define REQUEST_OVERRIDE_IMPL(type, method) static void type##_##method( \
     struct wl_resource* type, \
@@ -38,6 +46,7 @@ extern struct wl_display* display;
 #define RESOURCE_ARG(type, name, index) ASSERT(type_code_at_index(message, index) == 'o'); ASSERT(message->types[index] == &type##_interface); struct wl_resource* name = (struct wl_resource*)args[index].o;
 #define UINT_ARG(name, index) ASSERT(type_code_at_index(message, index) == 'u'); uint32_t name = args[index].u;
 #define INT_ARG(name, index) ASSERT(type_code_at_index(message, index) == 'i'); int32_t name = args[index].i;
+#define FD_ARG(name, index) ASSERT(type_code_at_index(message, index) == 'h'); int32_t name = args[index].h;
 
 typedef void (*request_override_function_t)(struct wl_resource* resource, const struct wl_message* message, struct wl_resource* created, union wl_argument* args);
 void install_request_override(const struct wl_interface* interface, const char* name, request_override_function_t function);
@@ -48,3 +57,16 @@ char type_code_at_index(const struct wl_message* message, int index);
 void init();
 void register_client(struct wl_client* client);
 const char* handle_command(const char** argv);
+// Splits a command line into arguments (modifying it) and runs it
+const char* execute_command_line(char* command);
+
+// Protocol recording and replay, see record-replay.c
+void record_replay_init();
+void record_replay_client_connected();
+int record_replay_finish(); // Returns non-zero if a replay diverged from its recording
+void record_command(const char* command, const char* response);
+void record_delay(int event_type, double ms);
+bool replay_enabled();
+bool replay_next_delay(int event_type, double* ms); // Returns false if not replaying
+// Checks a command against the recording and runs it (modifying it), returns its response
+const char* replay_client_command(char* command);
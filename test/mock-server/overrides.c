@@ -11,22 +11,46 @@
 
 #include "mock-server.h"
 #include "linux/input.h"
+#include <inttypes.h>
+#include <math.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/param.h>
 
-#define OUTPUT_SLOTS 10
 struct output_data_t {
     struct wl_global* global;
-    int slot;
+    int id; // Given out in creation order and never reused, used by the destroy_output command
     int width, height;
+    int refresh_mhz; // Set by the set_refresh_rate command
+    int scale; // Set by the set_output_scale command
+    bool powered_off; // Set by the set_output_power command, frame callbacks of its surfaces are held while off
+    struct wl_event_source* vblank_timer; // Only exists when frame callbacks are paced
+    int64_t next_vblank_us;
+    struct wl_list resources; // The wl_output resources bound to this output, their user data is this struct
+    struct wl_list link;
 };
 
-#define CLIENT_SLOTS 10
 struct client_data_t {
     struct wl_client* client;
-    int slot;
+    int id;
     struct wl_listener disconnect_listener;
     struct wl_resource* seat;
     struct wl_resource* pointer;
-    struct wl_resource* outputs[OUTPUT_SLOTS];
+    struct wl_list link;
+};
+
+// The memory of a wl_shm_pool, shared by the pool and every buffer created from it
+struct shm_pool_data_t {
+    int fd;
+    void* data; // NULL if it could not be mapped
+    int32_t size;
+    int refs;
+};
+
+// User data of a wl_buffer created from a wl_shm_pool
+struct shm_buffer_data_t {
+    struct shm_pool_data_t* pool;
+    int32_t offset, width, height, stride;
 };
 
 enum surface_role_t {
@@ -37,13 +61,21 @@ enum surface_role_t {
     SURFACE_ROLE_SESSION_LOCK,
 };
 
-#define SURFACE_SLOTS 20
+// Owned by the wl_surface resource, and freed when it's destroyed (including when its client disconnects)
 struct surface_data_t {
     struct client_data_t* client;
     enum surface_role_t role;
     struct wl_resource* surface;
-    struct wl_resource* pending_frame;
+    // wl_callback and wp_presentation_feedback resources requested since the last commit
+    struct wl_list pending_frames;
+    // Same as above, but committed and waiting for the next vblank (where feedback is sent as presented)
+    struct wl_list committed_frames;
     struct wl_resource* pending_buffer; // The attached but not committed buffer
+    uint64_t pending_damage_rects; // Damage since the last commit
+    uint64_t pending_damage_area; // In pixels, each rectangle is clipped to the buffer but overlaps are counted twice
+    uint64_t content_hash; // Hash of the pixels of the most recently committed buffer
+    bool has_content_hash;
+    int32_t buffer_width, buffer_height; // Size of the most recently committed shm buffer
     bool buffer_cleared; // If the buffer has been explicitly cleared since the last commit
     bool pending_window_geom; // If the window geom has been set since last commit
     struct wl_resource* xdg_toplevel;
@@ -69,41 +101,57 @@ struct surface_data_t {
     struct surface_data_t* popup_parent;
     struct output_data_t* explicit_output; // The output requested by the client, or NULL if none
     struct output_data_t* effective_output; // The output this surface is on, or NULL if none
+    struct wl_list link;
 };
 
-int next_output_slot = 0;
-static struct output_data_t outputs[OUTPUT_SLOTS] = {0};
+static struct wl_list outputs; // output_data_t, in creation order
+static struct wl_list clients; // client_data_t
+static struct wl_list surfaces; // surface_data_t
+static struct wl_list fractional_scales; // wp_fractional_scale_v1 resources
+static int next_output_id = 0;
+static int next_client_id = 0;
 
 static void create_output(int width, int height);
-static void destroy_output(int slot);
-static struct client_data_t clients[CLIENT_SLOTS] = {0};
-static struct surface_data_t surfaces[SURFACE_SLOTS] = {0};
+static void destroy_output(struct output_data_t* output);
 static struct wl_resource* current_session_lock = NULL;
-bool configure_delay_enabled = false;
-bool destroy_outputs_on_layer_surface_create = false;
-int next_surface_slot = 0;
-struct surface_data_t* latest_surface = NULL;
-
+static bool destroy_outputs_on_layer_surface_create = false;
+static uint64_t commit_count = 0; // Reported by the get_stats command
+static uint64_t attach_count = 0; // Only counts non-null buffers, reported by the get_stats command
+static uint64_t frame_count = 0; // Frame callbacks sent, reported by the get_stats command
+static uint64_t presentation_seq = 0; // Vblank counter sent with presentation feedback
+// Also reported by get_stats, these only count shm buffers
+static uint64_t bytes_attached = 0; // Size of each buffer committed
+static uint64_t damage_rect_count = 0;
+static uint64_t damage_area = 0; // In pixels
+static uint64_t unchanged_commit_count = 0; // Commits of a new buffer with the same pixels as the previous one
+// Times a frame callback was held back a vblank, reported by the get_stats command
+static uint64_t dropped_frame_count = 0;
+// If frame callbacks wait for their output's next vblank instead of being sent on commit
+static bool frames_paced = false;
+static double frame_drop_rate = 0; // The chance each waiting frame callback misses a vblank
+static uint32_t preferred_scale = 120; // Sent to each wp_fractional_scale_v1, in 120ths
+static struct surface_data_t* latest_surface = NULL;
+
+// Returns NULL if the output has been destroyed
 static struct output_data_t* find_output(struct wl_resource* resource) {
-    for (int client_i = 0; client_i < CLIENT_SLOTS; client_i++)
-        for (int output_i = 0; output_i < next_output_slot; output_i++)
-            if (clients[client_i].outputs[output_i] == resource)
-                return &outputs[output_i];
-    return NULL;
+    return wl_resource_get_user_data(resource);
 }
 
 static struct output_data_t* default_output() {
-    for (int i = 0; i < next_output_slot; i++)
-        if (outputs[i].global)
-            return &outputs[i];
-    return NULL;
+    if (wl_list_empty(&outputs))
+        return NULL;
+    struct output_data_t* output = wl_container_of(outputs.next, output, link);
+    return output;
 }
 
+static void client_disconnect(struct wl_listener *listener, void *data);
+
 static struct client_data_t* client_from_wl_client(struct wl_client* client) {
-    for (int i = 0; i < CLIENT_SLOTS; i++)
-        if (clients[i].client == client)
-            return &clients[i];
-    FATAL_FMT("invalid client %p", (void*)client);
+    struct wl_listener* listener = wl_client_get_destroy_listener(client, client_disconnect);
+    if (!listener)
+        FATAL_FMT("invalid client %p", (void*)client);
+    struct client_data_t* client_data = wl_container_of(listener, client_data, disconnect_listener);
+    return client_data;
 }
 
 static struct client_data_t* client_from_wl_resource(struct wl_resource* resource) {
@@ -155,8 +203,29 @@ static void surface_data_add_pupup(struct surface_data_t* parent, struct surface
     popup->popup_parent = parent;
 }
 
+// Takes the surface out of its parent's popup list, and forgets its own popups
+static void surface_data_detach_popups(struct surface_data_t* data) {
+    if (data->popup_parent) {
+        struct surface_data_t** popup = &data->popup_parent->most_recent_popup;
+        while (*popup && *popup != data) {
+            popup = &(*popup)->previous_popup_sibling;
+        }
+        if (*popup) {
+            *popup = data->previous_popup_sibling;
+        }
+    }
+    while (data->most_recent_popup) {
+        struct surface_data_t* popup = data->most_recent_popup;
+        data->most_recent_popup = popup->previous_popup_sibling;
+        popup->popup_parent = NULL;
+        popup->previous_popup_sibling = NULL;
+    }
+    data->popup_parent = NULL;
+    data->previous_popup_sibling = NULL;
+}
+
 static void surface_data_send_configure(struct surface_data_t* data) {
-    data->configure_serial = wl_display_next_serial(display);
+    data->configure_serial = wl_display_next_serial(mock_server_display);
     switch (data->role) {
         case SURFACE_ROLE_NONE:
             break;
@@ -218,28 +287,358 @@ static void surface_data_send_configure(struct surface_data_t* data) {
     }
 }
 
-static int surface_data_configure_timer_callback(void *data) {
-    surface_data_send_configure(data);
+// Events the compositor can be told to delay with the set_latency command
+enum latency_event_t {
+    LATENCY_EVENT_CONFIGURE = 0,
+    LATENCY_EVENT_FRAME, // wl_callback.done for frame callbacks
+    LATENCY_EVENT_RELEASE, // wl_buffer.release
+    LATENCY_EVENT_COUNT,
+};
+
+static const char* latency_event_names[LATENCY_EVENT_COUNT] = {"configure", "frame", "release"};
+
+enum latency_model_t {
+    LATENCY_MODEL_NONE = 0, // Events are sent immediately
+    LATENCY_MODEL_FIXED, // Every event takes a (ms)
+    LATENCY_MODEL_UNIFORM, // Evenly distributed between a and b (ms)
+    LATENCY_MODEL_LONG_TAIL, // Log-normal with a median of a and a 99th percentile of b (ms)
+};
+
+struct latency_profile_t {
+    enum latency_model_t model;
+    double a, b;
+};
+
+static struct latency_profile_t latency_profiles[LATENCY_EVENT_COUNT] = {0};
+static uint64_t latency_rng_state = 1; // Set by the set_latency_seed command, so runs are reproducible
+
+// splitmix64, which is fine with any seed including 0. Returns a number in [0, 1)
+static double latency_random() {
+    uint64_t z = (latency_rng_state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    z = z ^ (z >> 31);
+    return (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Returns how long the given event should take in milliseconds
+static double latency_sample(enum latency_event_t event) {
+    struct latency_profile_t* profile = &latency_profiles[event];
+    switch (profile->model) {
+        case LATENCY_MODEL_NONE:
+            return 0;
+
+        case LATENCY_MODEL_FIXED:
+            return profile->a;
+
+        case LATENCY_MODEL_UNIFORM:
+            return profile->a + (profile->b - profile->a) * latency_random();
+
+        case LATENCY_MODEL_LONG_TAIL: {
+            // Box-Muller gives a standard normal sample, 2.326 is its 99th percentile
+            double normal = sqrt(-2.0 * log(1.0 - latency_random())) * cos(2.0 * M_PI * latency_random());
+            double sigma = log(profile->b / profile->a) / 2.326;
+            return profile->a * exp(sigma * normal);
+        }
+    }
+    FATAL_FMT("invalid latency model %d", profile->model);
+}
+
+typedef void (*delayed_send_function_t)(struct wl_resource* resource);
+
+// An event waiting on its latency, cancelled if the resource it's sent on is destroyed first
+struct delayed_event_t {
+    struct wl_event_source* timer;
+    struct wl_listener resource_destroy_listener;
+    struct wl_resource* resource;
+    delayed_send_function_t send;
+    enum latency_event_t type;
+    int64_t queued_us; // When the event would have been sent without a latency
+};
+
+// How long delayed events of one type actually took to be sent, reported by the get_stats command
+struct latency_stats_t {
+    uint64_t count;
+    int64_t min_us, max_us;
+};
+
+static struct latency_stats_t latency_stats[LATENCY_EVENT_COUNT] = {0};
+
+static int64_t monotonic_time_us() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void delayed_event_free(struct delayed_event_t* event) {
+    wl_list_remove(&event->resource_destroy_listener.link);
+    wl_event_source_remove(event->timer);
+    free(event);
+}
+
+static int delayed_event_timer_callback(void* data) {
+    struct delayed_event_t* event = data;
+    struct wl_resource* resource = event->resource;
+    delayed_send_function_t send = event->send;
+    struct latency_stats_t* stats = &latency_stats[event->type];
+    int64_t elapsed_us = monotonic_time_us() - event->queued_us;
+    if (stats->count == 0 || elapsed_us < stats->min_us) stats->min_us = elapsed_us;
+    if (stats->count == 0 || elapsed_us > stats->max_us) stats->max_us = elapsed_us;
+    stats->count++;
+    // Sending may destroy the resource (frame callbacks are destroyed once done), so clean up first
+    delayed_event_free(event);
+    send(resource);
     return 0;
 }
 
+static void delayed_event_resource_destroyed(struct wl_listener* listener, void* data) {
+    struct delayed_event_t* event = wl_container_of(listener, event, resource_destroy_listener);
+    delayed_event_free(event);
+}
+
+// Calls send with the resource now or after the latency of the given event type
+static void send_with_latency(enum latency_event_t type, struct wl_resource* resource, delayed_send_function_t send) {
+    double latency;
+    if (!replay_next_delay(type, &latency)) {
+        latency = latency_sample(type);
+    }
+    record_delay(type, latency);
+    if (latency <= 0) {
+        send(resource);
+        return;
+    }
+    struct delayed_event_t* event = calloc(1, sizeof(struct delayed_event_t));
+    event->resource = resource;
+    event->send = send;
+    event->type = type;
+    event->queued_us = monotonic_time_us();
+    event->timer = wl_event_loop_add_timer(
+        wl_display_get_event_loop(mock_server_display),
+        delayed_event_timer_callback,
+        event);
+    event->resource_destroy_listener.notify = delayed_event_resource_destroyed;
+    wl_resource_add_destroy_listener(resource, &event->resource_destroy_listener);
+    // Rounded up, because a timeout of 0 would disarm the timer
+    wl_event_source_timer_update(event->timer, (int)ceil(latency));
+}
+
+static void send_configure_for_surface(struct wl_resource* surface) {
+    surface_data_send_configure(wl_resource_get_user_data(surface));
+}
+
 static void surface_data_queue_configure(struct surface_data_t* data) {
-    if (configure_delay_enabled) {
-        struct wl_event_source* source = wl_event_loop_add_timer(
-            wl_display_get_event_loop(display),
-            surface_data_configure_timer_callback,
-            data
-        );
-        wl_event_source_timer_update(source, 100);
-    } else {
-        surface_data_send_configure(data);
+    send_with_latency(LATENCY_EVENT_CONFIGURE, data->surface, send_configure_for_surface);
+}
+
+static void send_frame_done(struct wl_resource* callback) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (wl_resource_instance_of(callback, &wp_presentation_feedback_interface, NULL)) {
+        // Presented when a frame callback committed along with it would be sent, refresh set by send_frames()
+        uint32_t refresh_ns = (uint32_t)(uintptr_t)wl_resource_get_user_data(callback);
+        presentation_seq++;
+        wp_presentation_feedback_send_presented(
+            callback,
+            (uint32_t)((uint64_t)now.tv_sec >> 32), (uint32_t)now.tv_sec, now.tv_nsec,
+            refresh_ns,
+            (uint32_t)(presentation_seq >> 32), (uint32_t)presentation_seq,
+            WP_PRESENTATION_FEEDBACK_KIND_VSYNC);
+        wl_resource_destroy(callback);
+        return;
     }
+    wl_callback_send_done(callback, now.tv_sec * 1000 + now.tv_nsec / 1000000);
+    wl_resource_destroy(callback);
+    frame_count++;
+}
+
+static void frame_callback_destroy(struct wl_resource* callback) {
+    wl_list_remove(wl_resource_get_link(callback));
+}
+
+// Surfaces without an output of their own (such as popups) are paced by the default output
+static struct output_data_t* surface_data_get_frame_output(struct surface_data_t* data) {
+    return data->effective_output ? data->effective_output : default_output();
+}
+
+static void send_frames(struct surface_data_t* data, struct wl_list* callbacks) {
+    // Feedback reports the refresh interval of the output the surface is paced by. It's stored in the feedback now,
+    // since a delayed presented may not be sent until after the output is gone.
+    struct output_data_t* output = surface_data_get_frame_output(data);
+    uintptr_t refresh_ns = output ? (uintptr_t)(1000000000000 / output->refresh_mhz) : 0;
+    struct wl_resource* callback, * tmp;
+    wl_resource_for_each_safe(callback, tmp, callbacks) {
+        // Take it out of the list now, since a delayed done may not be sent until after the surface is gone
+        wl_list_remove(wl_resource_get_link(callback));
+        wl_list_init(wl_resource_get_link(callback));
+        if (wl_resource_instance_of(callback, &wp_presentation_feedback_interface, NULL))
+            wl_resource_set_user_data(callback, (void*)refresh_ns);
+        send_with_latency(LATENCY_EVENT_FRAME, callback, send_frame_done);
+    }
+}
+
+static void output_schedule_vblank(struct output_data_t* output) {
+    output->next_vblank_us += 1000000000 / output->refresh_mhz;
+    int64_t delay_us = output->next_vblank_us - monotonic_time_us();
+    if (delay_us < 1000) {
+        // We fell behind (or a timeout would round to 0, which disarms the timer), so skip ahead
+        output->next_vblank_us = monotonic_time_us() + 1000;
+        delay_us = 1000;
+    }
+    wl_event_source_timer_update(output->vblank_timer, (delay_us + 999) / 1000);
+}
+
+// If frame callbacks should wait instead of being sent on commit
+static bool surface_data_frames_held(struct surface_data_t* data) {
+    struct output_data_t* output = surface_data_get_frame_output(data);
+    return frames_paced || (output && output->powered_off);
+}
+
+static int output_vblank(void* data) {
+    struct output_data_t* output = data;
+    struct surface_data_t* surface;
+    wl_list_for_each(surface, &surfaces, link) {
+        if (output->powered_off ||
+            surface_data_get_frame_output(surface) != output ||
+            wl_list_empty(&surface->committed_frames)) {
+            continue;
+        }
+        if (frame_drop_rate > 0 && latency_random() < frame_drop_rate) {
+            dropped_frame_count++;
+            continue;
+        }
+        send_frames(surface, &surface->committed_frames);
+    }
+    output_schedule_vblank(output);
+    return 0;
+}
+
+static void output_set_paced(struct output_data_t* output, bool paced) {
+    if (paced && !output->vblank_timer) {
+        output->vblank_timer = wl_event_loop_add_timer(
+            wl_display_get_event_loop(mock_server_display),
+            output_vblank,
+            output);
+        output->next_vblank_us = monotonic_time_us();
+        output_schedule_vblank(output);
+    } else if (!paced && output->vblank_timer) {
+        wl_event_source_remove(output->vblank_timer);
+        output->vblank_timer = NULL;
+    }
+}
+
+static void send_buffer_release(struct wl_resource* buffer) {
+    wl_buffer_send_release(buffer);
 }
 
 REQUEST_OVERRIDE_IMPL(wl_surface, frame) {
     struct surface_data_t* data = wl_resource_get_user_data(wl_surface);
-    ASSERT(!data->pending_frame);
-    data->pending_frame = new_resource;
+    wl_resource_set_destructor(new_resource, frame_callback_destroy);
+    wl_list_insert(data->pending_frames.prev, wl_resource_get_link(new_resource));
+}
+
+static void shm_pool_data_unref(struct shm_pool_data_t* pool) {
+    pool->refs--;
+    if (pool->refs == 0) {
+        if (pool->data) munmap(pool->data, pool->size);
+        close(pool->fd);
+        free(pool);
+    }
+}
+
+static void shm_pool_data_map(struct shm_pool_data_t* pool) {
+    if (pool->data) munmap(pool->data, pool->size);
+    pool->data = mmap(NULL, pool->size, PROT_READ, MAP_SHARED, pool->fd, 0);
+    if (pool->data == MAP_FAILED) pool->data = NULL;
+}
+
+static void shm_pool_resource_destroy(struct wl_resource* resource) {
+    shm_pool_data_unref(wl_resource_get_user_data(resource));
+}
+
+REQUEST_OVERRIDE_IMPL(wl_shm, create_pool) {
+    FD_ARG(fd, 1);
+    INT_ARG(size, 2);
+    struct shm_pool_data_t* pool = calloc(1, sizeof(struct shm_pool_data_t));
+    pool->fd = fd;
+    pool->size = size;
+    pool->refs = 1;
+    shm_pool_data_map(pool);
+    wl_resource_set_user_data(new_resource, pool);
+    wl_resource_set_destructor(new_resource, shm_pool_resource_destroy);
+}
+
+REQUEST_OVERRIDE_IMPL(wl_shm_pool, resize) {
+    INT_ARG(size, 0);
+    struct shm_pool_data_t* pool = wl_resource_get_user_data(wl_shm_pool);
+    ASSERT(size >= pool->size);
+    // Buffers see the new mapping too, since they share this struct
+    pool->size = size;
+    shm_pool_data_map(pool);
+}
+
+static void shm_buffer_resource_destroy(struct wl_resource* resource) {
+    struct shm_buffer_data_t* buffer = wl_resource_get_user_data(resource);
+    shm_pool_data_unref(buffer->pool);
+    free(buffer);
+}
+
+REQUEST_OVERRIDE_IMPL(wl_shm_pool, create_buffer) {
+    INT_ARG(offset, 1);
+    INT_ARG(width, 2);
+    INT_ARG(height, 3);
+    INT_ARG(stride, 4);
+    struct shm_buffer_data_t* buffer = calloc(1, sizeof(struct shm_buffer_data_t));
+    buffer->pool = wl_resource_get_user_data(wl_shm_pool);
+    buffer->pool->refs++;
+    buffer->offset = offset;
+    buffer->width = width;
+    buffer->height = height;
+    buffer->stride = stride;
+    ASSERT(offset >= 0 && stride >= 0 && height >= 0);
+    ASSERT((int64_t)offset + (int64_t)stride * height <= buffer->pool->size);
+    wl_resource_set_user_data(new_resource, buffer);
+    wl_resource_set_destructor(new_resource, shm_buffer_resource_destroy);
+}
+
+// FNV-1a of the buffer's pixels (not the padding at the end of each row)
+static uint64_t shm_buffer_data_hash(struct shm_buffer_data_t* buffer) {
+    uint64_t hash = 0xcbf29ce484222325;
+    const uint8_t* row = (const uint8_t*)buffer->pool->data + buffer->offset;
+    size_t row_bytes = buffer->width * 4;
+    for (int y = 0; y < buffer->height; y++, row += buffer->stride) {
+        for (size_t x = 0; x < row_bytes && x < (size_t)buffer->stride; x++) {
+            hash = (hash ^ row[x]) * 0x100000001b3;
+        }
+    }
+    return hash;
+}
+
+static void surface_data_add_damage(struct surface_data_t* data, int32_t x, int32_t y, int32_t width, int32_t height) {
+    data->pending_damage_rects++;
+    // Clip to the buffer (GDK often damages with huge rectangles)
+    struct shm_buffer_data_t* buffer = data->pending_buffer ? wl_resource_get_user_data(data->pending_buffer) : NULL;
+    int64_t x0 = MAX(x, 0), y0 = MAX(y, 0);
+    int64_t x1 = MIN((int64_t)x + width, buffer ? buffer->width : data->buffer_width);
+    int64_t y1 = MIN((int64_t)y + height, buffer ? buffer->height : data->buffer_height);
+    if (x1 > x0 && y1 > y0) {
+        data->pending_damage_area += (x1 - x0) * (y1 - y0);
+    }
+}
+
+REQUEST_OVERRIDE_IMPL(wl_surface, damage) {
+    INT_ARG(x, 0);
+    INT_ARG(y, 1);
+    INT_ARG(width, 2);
+    INT_ARG(height, 3);
+    surface_data_add_damage(wl_resource_get_user_data(wl_surface), x, y, width, height);
+}
+
+REQUEST_OVERRIDE_IMPL(wl_surface, damage_buffer) {
+    INT_ARG(x, 0);
+    INT_ARG(y, 1);
+    INT_ARG(width, 2);
+    INT_ARG(height, 3);
+    surface_data_add_damage(wl_resource_get_user_data(wl_surface), x, y, width, height);
 }
 
 REQUEST_OVERRIDE_IMPL(wl_surface, attach) {
@@ -247,10 +646,14 @@ REQUEST_OVERRIDE_IMPL(wl_surface, attach) {
     struct surface_data_t* data = wl_resource_get_user_data(wl_surface);
     data->pending_buffer = buffer;
     data->buffer_cleared = buffer == NULL;
+    if (buffer) {
+        attach_count++;
+    }
 }
 
 REQUEST_OVERRIDE_IMPL(wl_surface, commit) {
     struct surface_data_t* data = wl_resource_get_user_data(wl_surface);
+    commit_count++;
 
     if (data->role == SURFACE_ROLE_SESSION_LOCK) {
         if (data->buffer_cleared) {
@@ -273,8 +676,31 @@ REQUEST_OVERRIDE_IMPL(wl_surface, commit) {
         FATAL("committed buffer before initial configure");
     }
 
+    damage_rect_count += data->pending_damage_rects;
+    damage_area += data->pending_damage_area;
+    data->pending_damage_rects = 0;
+    data->pending_damage_area = 0;
+
+    struct shm_buffer_data_t* shm_buffer = NULL;
+    if (data->pending_buffer) {
+        shm_buffer = wl_resource_get_user_data(data->pending_buffer);
+    }
+    if (shm_buffer) {
+        bytes_attached += (uint64_t)shm_buffer->stride * shm_buffer->height;
+        data->buffer_width = shm_buffer->width;
+        data->buffer_height = shm_buffer->height;
+        if (shm_buffer->pool->data) {
+            uint64_t hash = shm_buffer_data_hash(shm_buffer);
+            if (data->has_content_hash && hash == data->content_hash) {
+                unchanged_commit_count++;
+            }
+            data->content_hash = hash;
+            data->has_content_hash = true;
+        }
+    }
+
     if (data->pending_buffer) {
-        wl_buffer_send_release(data->pending_buffer);
+        send_with_latency(LATENCY_EVENT_RELEASE, data->pending_buffer, send_buffer_release);
         data->pending_buffer = NULL;
     }
 
@@ -283,10 +709,19 @@ REQUEST_OVERRIDE_IMPL(wl_surface, commit) {
         data->pending_window_geom = false;
     }
 
-    if (data->pending_frame) {
-        wl_callback_send_done(data->pending_frame, 0);
-        wl_resource_destroy(data->pending_frame);
-        data->pending_frame = NULL;
+    if (surface_data_frames_held(data)) {
+        // Feedback for content that never made it to a vblank is discarded
+        struct wl_resource* callback, * tmp;
+        wl_resource_for_each_safe(callback, tmp, &data->committed_frames) {
+            if (wl_resource_instance_of(callback, &wp_presentation_feedback_interface, NULL)) {
+                wp_presentation_feedback_send_discarded(callback);
+                wl_resource_destroy(callback);
+            }
+        }
+        wl_list_insert_list(data->committed_frames.prev, &data->pending_frames);
+        wl_list_init(&data->pending_frames);
+    } else {
+        send_frames(data, &data->pending_frames);
     }
 
     if (data->initial_commit_for_role && data->role != SURFACE_ROLE_SESSION_LOCK) {
@@ -305,12 +740,42 @@ REQUEST_OVERRIDE_IMPL(wl_surface, destroy) {
     data->surface = NULL;
 }
 
+static void surface_data_destroy(struct wl_resource* surface) {
+    struct surface_data_t* data = wl_resource_get_user_data(surface);
+    surface_data_detach_popups(data);
+    // Frame callbacks of a destroyed surface are never sent, but they stay around until the client destroys them
+    struct wl_list* frame_lists[] = {&data->pending_frames, &data->committed_frames};
+    for (size_t i = 0; i < sizeof(frame_lists) / sizeof(frame_lists[0]); i++) {
+        struct wl_resource* callback, * tmp;
+        wl_resource_for_each_safe(callback, tmp, frame_lists[i]) {
+            wl_list_remove(wl_resource_get_link(callback));
+            wl_list_init(wl_resource_get_link(callback));
+        }
+    }
+    // Role objects outliving their surface is a protocol error, but don't leave them pointing at freed memory
+    struct wl_resource* role_objects[] = {
+        data->xdg_surface, data->xdg_toplevel, data->xdg_popup, data->layer_surface, data->lock_surface,
+    };
+    for (size_t i = 0; i < sizeof(role_objects) / sizeof(role_objects[0]); i++) {
+        if (role_objects[i]) {
+            wl_resource_set_user_data(role_objects[i], NULL);
+        }
+    }
+    if (latest_surface == data) {
+        latest_surface = NULL;
+    }
+    wl_list_remove(&data->link);
+    free(data);
+}
+
 REQUEST_OVERRIDE_IMPL(wl_compositor, create_surface) {
     struct client_data_t* client_data = client_from_wl_resource(wl_compositor);
-    ASSERT(next_surface_slot < SURFACE_SLOTS);
-    struct surface_data_t* data = &surfaces[next_surface_slot];
-    next_surface_slot++;
+    struct surface_data_t* data = calloc(1, sizeof(struct surface_data_t));
+    wl_list_insert(&surfaces, &data->link);
     wl_resource_set_user_data(new_resource, data);
+    wl_resource_set_destructor(new_resource, surface_data_destroy);
+    wl_list_init(&data->pending_frames);
+    wl_list_init(&data->committed_frames);
     data->client = client_data;
     data->surface = new_resource;
     latest_surface = data;
@@ -324,14 +789,20 @@ void wl_seat_bind(struct wl_client* client, void* data, uint32_t version, uint32
     wl_seat_send_capabilities(client_data->seat, WL_SEAT_CAPABILITY_POINTER | WL_SEAT_CAPABILITY_KEYBOARD);
 };
 
+static void wl_output_resource_destroy(struct wl_resource* resource) {
+    wl_list_remove(wl_resource_get_link(resource));
+}
+
 void wl_output_bind(struct wl_client* client, void* data, uint32_t version, uint32_t id) {
     struct output_data_t* output = data;
-    struct client_data_t* client_data = client_from_wl_client(client);
-    ASSERT(!client_data->outputs[output->slot]);
+    ASSERT(!wl_resource_find_for_client(&output->resources, client));
     struct wl_resource* resource = wl_resource_create(client, &wl_output_interface, version, id);
     use_default_impl(resource);
-    client_data->outputs[output->slot] = resource;
-    wl_output_send_mode(resource, WL_OUTPUT_MODE_CURRENT, output->width, output->height, 60000);
+    wl_resource_set_user_data(resource, output);
+    wl_resource_set_destructor(resource, wl_output_resource_destroy);
+    wl_list_insert(&output->resources, wl_resource_get_link(resource));
+    wl_output_send_mode(resource, WL_OUTPUT_MODE_CURRENT, output->width, output->height, output->refresh_mhz);
+    wl_output_send_scale(resource, output->scale);
     wl_output_send_done(resource);
 };
 
@@ -353,9 +824,7 @@ REQUEST_OVERRIDE_IMPL(xdg_surface, destroy) {
     ASSERT(!data->xdg_toplevel);
     ASSERT(!data->xdg_popup);
     data->xdg_surface = NULL;
-    data->popup_parent = NULL;
-    data->previous_popup_sibling = NULL;
-    data->most_recent_popup = NULL;
+    surface_data_detach_popups(data);
 }
 
 REQUEST_OVERRIDE_IMPL(xdg_surface, set_window_geometry) {
@@ -476,10 +945,9 @@ REQUEST_OVERRIDE_IMPL(zwlr_layer_shell_v1, get_layer_surface) {
     data->effective_output = data->explicit_output ? data->explicit_output : default_output();
 
     if (destroy_outputs_on_layer_surface_create) {
-        for (int i = 0; i < OUTPUT_SLOTS; i++) {
-            if (outputs[i].global) {
-                destroy_output(i);
-            }
+        struct output_data_t* output, * tmp;
+        wl_list_for_each_safe(output, tmp, &outputs, link) {
+            destroy_output(output);
         }
         data->layer_is_closed = true;
         destroy_outputs_on_layer_surface_create = false;
@@ -500,6 +968,31 @@ REQUEST_OVERRIDE_IMPL(zwlr_layer_surface_v1, destroy) {
     surface_data_unmap(data);
 }
 
+static void fractional_scale_resource_destroy(struct wl_resource* resource) {
+    wl_list_remove(wl_resource_get_link(resource));
+}
+
+void wp_presentation_bind(struct wl_client* client, void* data, uint32_t version, uint32_t id) {
+    (void)data;
+    struct wl_resource* resource = wl_resource_create(client, &wp_presentation_interface, version, id);
+    use_default_impl(resource);
+    wp_presentation_send_clock_id(resource, CLOCK_MONOTONIC);
+};
+
+REQUEST_OVERRIDE_IMPL(wp_presentation, feedback) {
+    RESOURCE_ARG(wl_surface, surface, 0);
+    struct surface_data_t* data = wl_resource_get_user_data(surface);
+    // Kept along with frame callbacks, so it's presented when they're done
+    wl_resource_set_destructor(new_resource, frame_callback_destroy);
+    wl_list_insert(data->pending_frames.prev, wl_resource_get_link(new_resource));
+}
+
+REQUEST_OVERRIDE_IMPL(wp_fractional_scale_manager_v1, get_fractional_scale) {
+    wl_resource_set_destructor(new_resource, fractional_scale_resource_destroy);
+    wl_list_insert(&fractional_scales, wl_resource_get_link(new_resource));
+    wp_fractional_scale_v1_send_preferred_scale(new_resource, preferred_scale);
+}
+
 REQUEST_OVERRIDE_IMPL(ext_session_lock_manager_v1, lock) {
     if (current_session_lock) {
         ext_session_lock_v1_send_finished(new_resource);
@@ -548,35 +1041,67 @@ REQUEST_OVERRIDE_IMPL(ext_session_lock_surface_v1, destroy) {
 }
 
 static void create_output(int width, int height) {
-    ASSERT(next_output_slot < OUTPUT_SLOTS);
-    outputs[next_output_slot] = (struct output_data_t) {
-        .global = wl_global_create(display, &wl_output_interface, 2, &outputs[next_output_slot], wl_output_bind),
-        .slot = next_output_slot,
-        .width = width,
-        .height = height,
-    };
-    next_output_slot++;
+    struct output_data_t* output = calloc(1, sizeof(struct output_data_t));
+    output->global = wl_global_create(mock_server_display, &wl_output_interface, 2, output, wl_output_bind);
+    output->id = next_output_id++;
+    output->width = width;
+    output->height = height;
+    output->refresh_mhz = 60000;
+    output->scale = 1;
+    wl_list_init(&output->resources);
+    wl_list_insert(outputs.prev, &output->link);
+    output_set_paced(output, frames_paced);
 }
 
-static void destroy_output(int slot) {
-    struct output_data_t* output = &outputs[slot];
-    for (int i = 0; i < next_surface_slot; i++) {
-        if (surfaces[i].layer_surface && surfaces[i].effective_output == output) {
-            zwlr_layer_surface_v1_send_closed(surfaces[i].layer_surface);
-            surfaces[i].layer_is_closed = true;
+static struct output_data_t* output_from_id(int id) {
+    struct output_data_t* output;
+    wl_list_for_each(output, &outputs, link) {
+        if (output->id == id)
+            return output;
+    }
+    FATAL_FMT("invalid output %d", id);
+}
+
+static void destroy_output(struct output_data_t* output) {
+    struct surface_data_t* surface;
+    wl_list_for_each(surface, &surfaces, link) {
+        if (surface->layer_surface && surface->effective_output == output) {
+            zwlr_layer_surface_v1_send_closed(surface->layer_surface);
+            surface->layer_is_closed = true;
         }
+        if (surface->effective_output == output)
+            surface->effective_output = NULL;
+        if (surface->explicit_output == output)
+            surface->explicit_output = NULL;
     }
-    if (slot < 0 || slot >= OUTPUT_SLOTS || !outputs[slot].global)
-        FATAL_FMT("destroying invalid output %d", slot);
+    // Clients may still make requests on their wl_outputs, so they need to stop pointing at the output
+    struct wl_resource* resource, * tmp;
+    wl_resource_for_each_safe(resource, tmp, &output->resources) {
+        wl_resource_set_user_data(resource, NULL);
+        wl_list_remove(wl_resource_get_link(resource));
+        wl_list_init(wl_resource_get_link(resource));
+    }
+    output_set_paced(output, false);
     wl_global_remove(output->global);
-    *output = (struct output_data_t){0};
+    wl_list_remove(&output->link);
+    free(output);
 }
 
 void init() {
+    wl_list_init(&outputs);
+    wl_list_init(&clients);
+    wl_list_init(&surfaces);
+    wl_list_init(&fractional_scales);
+
     OVERRIDE_REQUEST(wl_surface, commit);
     OVERRIDE_REQUEST(wl_surface, frame);
     OVERRIDE_REQUEST(wl_surface, attach);
     OVERRIDE_REQUEST(wl_surface, destroy);
+    OVERRIDE_REQUEST(wl_surface, damage);
+    OVERRIDE_REQUEST(wl_surface, damage_buffer);
+    OVERRIDE_REQUEST(wl_shm, create_pool);
+    OVERRIDE_REQUEST(wl_shm_pool, resize);
+    OVERRIDE_REQUEST(wl_shm_pool, create_buffer);
     OVERRIDE_REQUEST(wl_compositor, create_surface);
     OVERRIDE_REQUEST(wl_seat, get_pointer);
     OVERRIDE_REQUEST(xdg_wm_base, get_xdg_surface);
@@ -601,47 +1126,51 @@ void init() {
     OVERRIDE_REQUEST(ext_session_lock_v1, get_lock_surface);
     OVERRIDE_REQUEST(ext_session_lock_surface_v1, ack_configure);
     OVERRIDE_REQUEST(ext_session_lock_surface_v1, destroy);
+    OVERRIDE_REQUEST(wp_fractional_scale_manager_v1, get_fractional_scale);
+    OVERRIDE_REQUEST(wp_presentation, feedback);
 
     create_output(DEFAULT_OUTPUT_WIDTH, DEFAULT_OUTPUT_HEIGHT);
 
-    wl_global_create(display, &wl_seat_interface, 6, NULL, wl_seat_bind);
-    default_global_create(display, &wl_shm_interface, 1);
-    default_global_create(display, &wl_data_device_manager_interface, 2);
-    default_global_create(display, &wl_compositor_interface, 4);
-    default_global_create(display, &wl_subcompositor_interface, 1);
-    default_global_create(display, &xdg_wm_base_interface, 2);
-    default_global_create(display, &zwlr_layer_shell_v1_interface, 4);
-    default_global_create(display, &ext_session_lock_manager_v1_interface, 1);
-    default_global_create(display, &xdg_wm_dialog_v1_interface, 1);
+    wl_global_create(mock_server_display, &wl_seat_interface, 6, NULL, wl_seat_bind);
+    default_global_create(mock_server_display, &wl_shm_interface, 1);
+    default_global_create(mock_server_display, &wl_data_device_manager_interface, 2);
+    default_global_create(mock_server_display, &wl_compositor_interface, 4);
+    default_global_create(mock_server_display, &wl_subcompositor_interface, 1);
+    default_global_create(mock_server_display, &xdg_wm_base_interface, 2);
+    default_global_create(mock_server_display, &zwlr_layer_shell_v1_interface, 4);
+    default_global_create(mock_server_display, &ext_session_lock_manager_v1_interface, 1);
+    default_global_create(mock_server_display, &xdg_wm_dialog_v1_interface, 1);
+    default_global_create(mock_server_display, &wp_viewporter_interface, 1);
+    default_global_create(mock_server_display, &wp_fractional_scale_manager_v1_interface, 1);
+    default_global_create(mock_server_display, &wp_single_pixel_buffer_manager_v1_interface, 1);
+    wl_global_create(mock_server_display, &wp_presentation_interface, 1, NULL, wp_presentation_bind);
 }
 
 static void client_disconnect(struct wl_listener *listener, void *data) {
-    struct wl_client* client = (struct wl_client*)data;
-    struct client_data_t* client_data = client_from_wl_client(client);
-    *client_data = (struct client_data_t){0};
-    fprintf(stderr, "Client %d disconnected\n", client_data->slot);
-    bool clients_still_connected = false;
-    for (int i = 0; i < CLIENT_SLOTS; i++) if (clients[i].client) clients_still_connected = true;
-    if (!clients_still_connected) {
+    struct client_data_t* client_data = wl_container_of(listener, client_data, disconnect_listener);
+    fprintf(stderr, "Client %d disconnected\n", client_data->id);
+    // The client's surfaces are freed as its resources are destroyed, which happens after this
+    struct surface_data_t* surface;
+    wl_list_for_each(surface, &surfaces, link) {
+        if (surface->client == client_data)
+            surface->client = NULL;
+    }
+    wl_list_remove(&client_data->link);
+    free(client_data);
+    if (wl_list_empty(&clients)) {
         fprintf(stderr, "Shutting down\n");
-        wl_display_terminate(display);
+        wl_display_terminate(mock_server_display);
     }
 }
 
 void register_client(struct wl_client* client) {
-    for (int i = 0; i < CLIENT_SLOTS; i++) {
-        if (!clients[i].client) {
-            clients[i] = (struct client_data_t) {
-                .client = client,
-                .slot = i,
-                .disconnect_listener.notify = client_disconnect,
-            };
-            fprintf(stderr, "Client %d connected\n", i);
-            wl_client_add_destroy_listener(client, &clients[i].disconnect_listener);
-            return;
-        }
-    }
-    FATAL("ran out of client slots");
+    struct client_data_t* client_data = calloc(1, sizeof(struct client_data_t));
+    client_data->client = client;
+    client_data->id = next_client_id++;
+    client_data->disconnect_listener.notify = client_disconnect;
+    wl_list_insert(&clients, &client_data->link);
+    fprintf(stderr, "Client %d connected\n", client_data->id);
+    wl_client_add_destroy_listener(client, &client_data->disconnect_listener);
 }
 
 static double parse_number(const char* str) {
@@ -668,8 +1197,35 @@ const char* handle_command(const char** argv) {
     }
     fprintf(stderr, "\n");
     if (strcmp(argv[0], "enable_configure_delay") == 0) {
-        configure_delay_enabled = true;
+        latency_profiles[LATENCY_EVENT_CONFIGURE] = (struct latency_profile_t){LATENCY_MODEL_FIXED, 100, 0};
         return "configure_delay_enabled";
+    } else if (strcmp(argv[0], "set_latency") == 0) {
+        // set_latency <configure|frame|release> <none|fixed ms|uniform min-ms max-ms|longtail median-ms p99-ms>
+        ASSERT(argv[1] && argv[2]);
+        int event = -1;
+        for (int i = 0; i < LATENCY_EVENT_COUNT; i++) {
+            if (strcmp(argv[1], latency_event_names[i]) == 0) event = i;
+        }
+        if (event < 0) FATAL_FMT("unknown latency event %s", argv[1]);
+        struct latency_profile_t profile = {0};
+        if (strcmp(argv[2], "none") == 0) {
+            profile.model = LATENCY_MODEL_NONE;
+        } else if (strcmp(argv[2], "fixed") == 0) {
+            profile = (struct latency_profile_t){LATENCY_MODEL_FIXED, parse_number(argv[3]), 0};
+        } else if (strcmp(argv[2], "uniform") == 0) {
+            profile = (struct latency_profile_t){LATENCY_MODEL_UNIFORM, parse_number(argv[3]), parse_number(argv[4])};
+            ASSERT(profile.a <= profile.b);
+        } else if (strcmp(argv[2], "longtail") == 0) {
+            profile = (struct latency_profile_t){LATENCY_MODEL_LONG_TAIL, parse_number(argv[3]), parse_number(argv[4])};
+            ASSERT(profile.a > 0 && profile.a <= profile.b);
+        } else {
+            FATAL_FMT("unknown latency model %s", argv[2]);
+        }
+        latency_profiles[event] = profile;
+        return "latency_set";
+    } else if (strcmp(argv[0], "set_latency_seed") == 0) {
+        latency_rng_state = parse_number(argv[1]);
+        return "latency_seed_set";
     } else if (strcmp(argv[0], "destroy_outputs_on_layer_surface_create") == 0) {
         destroy_outputs_on_layer_surface_create = true;
         return "destroy_outputs_on_layer_surface_create_enabled";
@@ -681,12 +1237,17 @@ const char* handle_command(const char** argv) {
         ASSERT(latest_surface->client->pointer);
         wl_fixed_t x = wl_fixed_from_double(parse_number(argv[1]));
         wl_fixed_t y = wl_fixed_from_double(parse_number(argv[2]));
-        wl_pointer_send_enter(pointer, wl_display_next_serial(display), latest_surface->surface, x, y);
+        wl_pointer_send_enter(pointer, wl_display_next_serial(mock_server_display), latest_surface->surface, x, y);
         wl_pointer_send_frame(pointer);
-        latest_surface->click_serial = wl_display_next_serial(display);
+        latest_surface->click_serial = wl_display_next_serial(mock_server_display);
         wl_pointer_send_button(pointer, latest_surface->click_serial, 0, BTN_LEFT, WL_POINTER_BUTTON_STATE_PRESSED);
         wl_pointer_send_frame(pointer);
-        wl_pointer_send_button(pointer, wl_display_next_serial(display), 0, BTN_LEFT, WL_POINTER_BUTTON_STATE_RELEASED);
+        wl_pointer_send_button(
+            pointer,
+            wl_display_next_serial(mock_server_display),
+            0,
+            BTN_LEFT,
+            WL_POINTER_BUTTON_STATE_RELEASED);
         wl_pointer_send_frame(pointer);
         return "latest_surface_clicked";
     } else if (strcmp(argv[0], "create_output") == 0) {
@@ -695,9 +1256,114 @@ const char* handle_command(const char** argv) {
         create_output(width, height);
         return "output_created";
     } else if (strcmp(argv[0], "destroy_output") == 0) {
-        int slot = parse_number(argv[1]);
-        destroy_output(slot);
+        int id = parse_number(argv[1]);
+        destroy_output(output_from_id(id));
         return "output_destroyed";
+    } else if (strcmp(argv[0], "set_frame_pacing") == 0) {
+        // "refresh" holds frame callbacks until their output's next vblank, "immediate" (the default) sends on commit
+        if (strcmp(argv[1], "refresh") == 0) {
+            frames_paced = true;
+        } else if (strcmp(argv[1], "immediate") == 0) {
+            frames_paced = false;
+            struct surface_data_t* surface;
+            wl_list_for_each(surface, &surfaces, link) {
+                if (!surface_data_frames_held(surface)) {
+                    send_frames(surface, &surface->committed_frames);
+                }
+            }
+        } else {
+            FATAL_FMT("unknown frame pacing %s", argv[1]);
+        }
+        struct output_data_t* output;
+        wl_list_for_each(output, &outputs, link) {
+            output_set_paced(output, frames_paced);
+        }
+        return "frame_pacing_set";
+    } else if (strcmp(argv[0], "set_refresh_rate") == 0) {
+        // set_refresh_rate <output-id> <hz>
+        struct output_data_t* output = output_from_id(parse_number(argv[1]));
+        double hz = parse_number(argv[2]);
+        ASSERT(hz > 0);
+        output->refresh_mhz = hz * 1000;
+        struct wl_resource* resource;
+        wl_resource_for_each(resource, &output->resources) {
+            wl_output_send_mode(resource, WL_OUTPUT_MODE_CURRENT, output->width, output->height, output->refresh_mhz);
+            wl_output_send_done(resource);
+        }
+        return "refresh_rate_set";
+    } else if (strcmp(argv[0], "set_output_scale") == 0) {
+        // set_output_scale <output-id> <integer scale>
+        struct output_data_t* output = output_from_id(parse_number(argv[1]));
+        output->scale = parse_number(argv[2]);
+        ASSERT(output->scale >= 1);
+        struct wl_resource* resource;
+        wl_resource_for_each(resource, &output->resources) {
+            wl_output_send_scale(resource, output->scale);
+            wl_output_send_done(resource);
+        }
+        return "output_scale_set";
+    } else if (strcmp(argv[0], "set_output_power") == 0) {
+        // set_output_power <output-id> <on|off>, like DPMS, frame callbacks of surfaces on an output that is off are
+        // held until it is turned back on
+        struct output_data_t* output = output_from_id(parse_number(argv[1]));
+        if (strcmp(argv[2], "on") == 0) {
+            output->powered_off = false;
+            if (!frames_paced) {
+                struct surface_data_t* surface;
+                wl_list_for_each(surface, &surfaces, link) {
+                    if (surface_data_get_frame_output(surface) == output) {
+                        send_frames(surface, &surface->committed_frames);
+                    }
+                }
+            }
+        } else if (strcmp(argv[2], "off") == 0) {
+            output->powered_off = true;
+        } else {
+            FATAL_FMT("unknown output power %s", argv[2]);
+        }
+        return "output_power_set";
+    } else if (strcmp(argv[0], "set_frame_drop_rate") == 0) {
+        frame_drop_rate = parse_number(argv[1]);
+        ASSERT(frame_drop_rate >= 0 && frame_drop_rate < 1);
+        return "frame_drop_rate_set";
+    } else if (strcmp(argv[0], "set_preferred_scale") == 0) {
+        // set_preferred_scale <scale>, such as 1.5, sent to all current and future surfaces
+        double scale = parse_number(argv[1]);
+        ASSERT(scale > 0);
+        preferred_scale = round(scale * 120);
+        struct wl_resource* resource;
+        wl_resource_for_each(resource, &fractional_scales) {
+            wp_fractional_scale_v1_send_preferred_scale(resource, preferred_scale);
+        }
+        return "preferred_scale_set";
+    } else if (strcmp(argv[0], "get_stats") == 0) {
+        static char response[1024];
+        int length = snprintf(
+            response,
+            sizeof(response),
+            "stats requests=%" PRIu64 " commits=%" PRIu64 " attaches=%" PRIu64
+            " frames=%" PRIu64 " dropped_frames=%" PRIu64
+            " bytes_attached=%" PRIu64 " damage_rects=%" PRIu64 " damage_area=%" PRIu64 " unchanged_commits=%" PRIu64,
+            mock_server_request_count,
+            commit_count,
+            attach_count,
+            frame_count,
+            dropped_frame_count,
+            bytes_attached,
+            damage_rect_count,
+            damage_area,
+            unchanged_commit_count);
+        for (int i = 0; i < LATENCY_EVENT_COUNT; i++) {
+            const char* name = latency_event_names[i];
+            length += snprintf(
+                response + length,
+                sizeof(response) - length,
+                " %s_delays=%" PRIu64 " %s_delay_min_us=%" PRId64 " %s_delay_max_us=%" PRId64,
+                name, latency_stats[i].count,
+                name, latency_stats[i].min_us,
+                name, latency_stats[i].max_us);
+        }
+        return response;
     } else {
         FATAL_FMT("unkown command: %s", argv[0]);
     }
@@ -0,0 +1,398 @@
+/* This entire file is licensed under MIT
+ *
+ * Copyright 2020 Sophie Winter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the "Software"), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+// Records everything a mock server run does, and replays the recording against a client
+//
+// GTKLS_MOCK_RECORD=<path> writes a recording. GTKLS_MOCK_REPLAY=<path> replays one: configure, frame and release
+// events get the recorded latencies, so a deterministic client sees the same event sequence with the same timing.
+// Commands the client sends during a replay must match the recording. Each one runs when it arrives and is answered
+// once it has run, so the client never acts on a response before its effect (or sees the effect before it asked),
+// however fast it runs compared to the recording. Each event sent and each response is compared with the recording,
+// and the run fails if they diverge.
+//
+// A recording starts with RECORDING_MAGIC, followed by records. Each record is a varint of microseconds since the
+// previous record, a record_type_t byte and its payload. Varints are unsigned LEB128, signed values are zigzag
+// encoded and strings are a varint length followed by the bytes.
+
+#include "mock-server.h"
+#include <time.h>
+#include <stdint.h>
+
+#define RECORDING_MAGIC "GTKLSMR1"
+
+enum record_type_t {
+    RECORD_INTERFACE = 0, // string name, gets the next interface index
+    RECORD_REQUEST, // varint interface index, varint object ID, varint opcode, varint args length, args
+    RECORD_EVENT, // same as a request
+    RECORD_COMMAND, // string command, string response
+    RECORD_DELAY, // varint latency event type, varint microseconds
+};
+
+// A growable byte buffer
+struct bytes_t {
+    uint8_t* data;
+    size_t length;
+    size_t capacity;
+};
+
+static void bytes_append(struct bytes_t* bytes, const void* data, size_t length) {
+    if (bytes->length + length > bytes->capacity) {
+        bytes->capacity = bytes->capacity ? bytes->capacity * 2 : 256;
+        while (bytes->length + length > bytes->capacity) bytes->capacity *= 2;
+        bytes->data = realloc(bytes->data, bytes->capacity);
+        ASSERT(bytes->data);
+    }
+    memcpy(bytes->data + bytes->length, data, length);
+    bytes->length += length;
+}
+
+static void bytes_append_varint(struct bytes_t* bytes, uint64_t value) {
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        if (value) byte |= 0x80;
+        bytes_append(bytes, &byte, 1);
+    } while (value);
+}
+
+static void bytes_append_string(struct bytes_t* bytes, const char* str) {
+    size_t length = str ? strlen(str) : 0;
+    bytes_append_varint(bytes, length);
+    bytes_append(bytes, str, length);
+}
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t monotonic_us() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static int64_t start_us = -1; // When the first client connected, all times are relative to this
+
+static int64_t time_since_start_us() {
+    return start_us < 0 ? 0 : monotonic_us() - start_us;
+}
+
+// Recording
+
+static FILE* record_file = NULL;
+static int64_t last_record_us = 0;
+static struct bytes_t record = {0}; // The record being built
+static const char** recorded_interfaces = NULL; // Interface names, in the order they were recorded
+static size_t recorded_interface_count = 0;
+
+static void record_begin(enum record_type_t type) {
+    int64_t now = time_since_start_us();
+    record.length = 0;
+    bytes_append_varint(&record, now - last_record_us);
+    last_record_us = now;
+    uint8_t type_byte = type;
+    bytes_append(&record, &type_byte, 1);
+}
+
+static void record_end() {
+    ASSERT(fwrite(record.data, 1, record.length, record_file) == record.length);
+}
+
+static size_t record_interface(const char* name) {
+    for (size_t i = 0; i < recorded_interface_count; i++) {
+        if (strcmp(recorded_interfaces[i], name) == 0) return i;
+    }
+    record_begin(RECORD_INTERFACE);
+    bytes_append_string(&record, name);
+    record_end();
+    recorded_interfaces = realloc(recorded_interfaces, (recorded_interface_count + 1) * sizeof(*recorded_interfaces));
+    recorded_interfaces[recorded_interface_count] = name;
+    return recorded_interface_count++;
+}
+
+static uint32_t object_id(void* object) {
+    return object ? wl_resource_get_id(object) : 0;
+}
+
+static void record_message(enum wl_protocol_logger_type direction, const struct wl_protocol_logger_message* message) {
+    static struct bytes_t args = {0};
+    args.length = 0;
+    int i = 0;
+    for (const char* c = message->message->signature; *c; c++) {
+        if (!(*c >= 'a' && *c <= 'z')) continue;
+        union wl_argument* arg = &message->arguments[i++];
+        switch (*c) {
+            case 'i': bytes_append_varint(&args, zigzag(arg->i)); break;
+            case 'u': bytes_append_varint(&args, arg->u); break;
+            case 'f': bytes_append_varint(&args, zigzag(arg->f)); break;
+            case 's': bytes_append_string(&args, arg->s); break;
+            case 'o': bytes_append_varint(&args, object_id(arg->o)); break;
+            case 'n':
+                // Requests carry the new ID, events the created object
+                bytes_append_varint(&args, direction == WL_PROTOCOL_LOGGER_REQUEST ? arg->n : object_id(arg->o));
+                break;
+            case 'a':
+                bytes_append_varint(&args, arg->a ? arg->a->size : 0);
+                if (arg->a) bytes_append(&args, arg->a->data, arg->a->size);
+                break;
+            case 'h': break; // File descriptors mean nothing outside of this run
+        }
+    }
+    size_t interface = record_interface(wl_resource_get_class(message->resource));
+    record_begin(direction == WL_PROTOCOL_LOGGER_REQUEST ? RECORD_REQUEST : RECORD_EVENT);
+    bytes_append_varint(&record, interface);
+    bytes_append_varint(&record, wl_resource_get_id(message->resource));
+    bytes_append_varint(&record, message->message_opcode);
+    bytes_append_varint(&record, args.length);
+    bytes_append(&record, args.data, args.length);
+    record_end();
+}
+
+void record_command(const char* command, const char* response) {
+    if (!record_file) return;
+    record_begin(RECORD_COMMAND);
+    bytes_append_string(&record, command);
+    bytes_append_string(&record, response);
+    record_end();
+}
+
+void record_delay(int event_type, double ms) {
+    if (!record_file) return;
+    record_begin(RECORD_DELAY);
+    bytes_append_varint(&record, event_type);
+    bytes_append_varint(&record, (uint64_t)(ms * 1000));
+    record_end();
+}
+
+// Replaying
+
+struct replay_command_t {
+    char* command;
+    char* response;
+};
+
+struct replay_event_t {
+    const char* interface;
+    uint32_t opcode;
+};
+
+struct replay_delays_t {
+    double* ms;
+    size_t count;
+    size_t next;
+};
+
+static bool replaying = false;
+static struct replay_command_t* replay_commands = NULL;
+static size_t replay_command_count = 0;
+static size_t next_client_command = 0;
+static struct replay_event_t* replay_events = NULL;
+static size_t replay_event_count = 0;
+static size_t next_replay_event = 0;
+static bool replay_diverged = false;
+static struct replay_delays_t replay_delays[8] = {0}; // Indexed by latency event type
+
+static uint64_t read_varint(FILE* file, bool* eof) {
+    uint64_t value = 0;
+    for (int shift = 0; ; shift += 7) {
+        int byte = fgetc(file);
+        if (byte == EOF) {
+            if (eof && shift == 0) {
+                *eof = true;
+                return 0;
+            }
+            FATAL("recording ends in the middle of a record");
+        }
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+}
+
+static char* read_string(FILE* file) {
+    size_t length = read_varint(file, NULL);
+    char* str = malloc(length + 1);
+    ASSERT(fread(str, 1, length, file) == length);
+    str[length] = '\0';
+    return str;
+}
+
+#define ARRAY_PUSH(array, count, value) do { \
+    array = realloc(array, ((count) + 1) * sizeof(*(array))); \
+    array[(count)++] = value; \
+} while (0)
+
+static void replay_load(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) FATAL_FMT("could not open recording %s", path);
+    char magic[sizeof(RECORDING_MAGIC) - 1];
+    if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, RECORDING_MAGIC, sizeof(magic)))
+        FATAL_FMT("%s is not a mock server recording", path);
+    char** interfaces = NULL;
+    size_t interface_count = 0;
+    while (true) {
+        bool eof = false;
+        read_varint(file, &eof); // Time since the previous record, only the latencies are replayed
+        if (eof) break;
+        int type = fgetc(file);
+        switch (type) {
+            case RECORD_INTERFACE:
+                ARRAY_PUSH(interfaces, interface_count, read_string(file));
+                break;
+
+            case RECORD_REQUEST:
+            case RECORD_EVENT: {
+                size_t interface = read_varint(file, NULL);
+                read_varint(file, NULL); // object ID
+                uint32_t opcode = read_varint(file, NULL);
+                ASSERT(fseek(file, read_varint(file, NULL), SEEK_CUR) == 0); // args
+                ASSERT(interface < interface_count);
+                if (type == RECORD_EVENT) {
+                    struct replay_event_t event = {interfaces[interface], opcode};
+                    ARRAY_PUSH(replay_events, replay_event_count, event);
+                }
+                break;
+            }
+
+            case RECORD_COMMAND: {
+                struct replay_command_t command;
+                command.command = read_string(file);
+                command.response = read_string(file);
+                ARRAY_PUSH(replay_commands, replay_command_count, command);
+                break;
+            }
+
+            case RECORD_DELAY: {
+                size_t event_type = read_varint(file, NULL);
+                ASSERT(event_type < sizeof(replay_delays) / sizeof(replay_delays[0]));
+                struct replay_delays_t* delays = &replay_delays[event_type];
+                ARRAY_PUSH(delays->ms, delays->count, read_varint(file, NULL) / 1000.0);
+                break;
+            }
+
+            default:
+                FATAL_FMT("invalid record type %d in %s", type, path);
+        }
+    }
+    fclose(file);
+    fprintf(stderr, "Replaying %s: %zu commands, %zu events\n", path, replay_command_count, replay_event_count);
+}
+
+#undef ARRAY_PUSH
+
+bool replay_next_delay(int event_type, double* ms) {
+    if (!replaying) return false;
+    struct replay_delays_t* delays = &replay_delays[event_type];
+    // Once the recorded latencies run out everything is sent immediately
+    *ms = delays->next < delays->count ? delays->ms[delays->next++] : 0;
+    return true;
+}
+
+bool replay_enabled() {
+    return replaying;
+}
+
+const char* replay_client_command(char* command) {
+    if (next_client_command >= replay_command_count)
+        FATAL_FMT("replay diverged: client sent command \"%s\" after all recorded commands", command);
+    struct replay_command_t* recorded = &replay_commands[next_client_command++];
+    if (strcmp(command, recorded->command) != 0)
+        FATAL_FMT("replay diverged: client sent command \"%s\", recording has \"%s\"", command, recorded->command);
+    const char* response = execute_command_line(command);
+    if (!replay_diverged && strcmp(response, recorded->response) != 0) {
+        fprintf(
+            stderr,
+            "Replay diverged: command \"%s\" responded \"%s\", recording has \"%s\"\n",
+            recorded->command,
+            response,
+            recorded->response);
+        replay_diverged = true;
+    }
+    return response;
+}
+
+static void replay_check_event(const struct wl_protocol_logger_message* message) {
+    const char* interface = wl_resource_get_class(message->resource);
+    if (replay_diverged) return;
+    if (next_replay_event >= replay_event_count) {
+        fprintf(stderr, "Replay diverged: %s.%s sent after all recorded events\n", interface, message->message->name);
+        replay_diverged = true;
+        return;
+    }
+    struct replay_event_t* expected = &replay_events[next_replay_event];
+    if (strcmp(expected->interface, interface) != 0 || expected->opcode != message->message_opcode) {
+        fprintf(
+            stderr,
+            "Replay diverged at event %zu: expected %s opcode %u, got %s.%s\n",
+            next_replay_event,
+            expected->interface,
+            expected->opcode,
+            interface,
+            message->message->name);
+        replay_diverged = true;
+        return;
+    }
+    next_replay_event++;
+}
+
+// Shared
+
+static void protocol_logger(
+    void* data,
+    enum wl_protocol_logger_type direction,
+    const struct wl_protocol_logger_message* message
+) {
+    if (record_file) {
+        record_message(direction, message);
+    }
+    if (replaying && direction == WL_PROTOCOL_LOGGER_EVENT) {
+        replay_check_event(message);
+    }
+}
+
+void record_replay_init() {
+    const char* record_path = getenv("GTKLS_MOCK_RECORD");
+    const char* replay_path = getenv("GTKLS_MOCK_REPLAY");
+    if (record_path && *record_path) {
+        record_file = fopen(record_path, "wb");
+        if (!record_file) FATAL_FMT("could not open %s to record to", record_path);
+        ASSERT(fwrite(RECORDING_MAGIC, 1, strlen(RECORDING_MAGIC), record_file) == strlen(RECORDING_MAGIC));
+    }
+    if (replay_path && *replay_path) {
+        replay_load(replay_path);
+        replaying = true;
+    }
+    if (record_file || replaying) {
+        wl_display_add_protocol_logger(mock_server_display, protocol_logger, NULL);
+    }
+}
+
+void record_replay_client_connected() {
+    if (start_us >= 0) return;
+    start_us = monotonic_us();
+}
+
+int record_replay_finish() {
+    if (record_file) {
+        fclose(record_file);
+        record_file = NULL;
+    }
+    if (replaying) {
+        if (!replay_diverged && next_replay_event < replay_event_count) {
+            fprintf(stderr, "Replay diverged: only %zu of %zu recorded events were sent\n",
+                next_replay_event, replay_event_count);
+            replay_diverged = true;
+        }
+        if (replay_diverged) return 1;
+        fprintf(stderr, "Replay matched all %zu recorded events\n", replay_event_count);
+    }
+    return 0;
+}
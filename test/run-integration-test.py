@@ -12,7 +12,9 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 '''
 
 # This script runs an integration test. See test/README.md for details
-usage = 'Usage: python3 run-test <test-binary>'
+usage = (
+    'Usage: python3 run-test [--benchmark [--in-process] | --massif <bytes-per-surface-budget> | --record-replay] ' +
+    '<test-binary>')
 
 import os
 from os import path
@@ -21,6 +23,7 @@ import shutil
 import time
 import subprocess
 import threading
+import json
 from typing import List, Dict, Optional, Any
 
 valgrind_error_return_code = 123
@@ -197,6 +200,8 @@ def verify_result(lines: List[str]):
     '''Runs through the output of a client and verifies that all expectations pass, see the test README.md details'''
     assertions: List[List[str]] = []
     negative_assertions: List[List[str]] = []
+    # Each budget is [the most matching messages allowed, matching messages seen so far, tokens]
+    budgets: List[List[Any]] = []
     section_start = 0
     set_expectation = False
     checked_expectation = False
@@ -208,6 +213,10 @@ def verify_result(lines: List[str]):
         elif line.startswith('UNEXPECT: '):
             negative_assertions.append(line.split()[1:])
             set_expectation = True
+        elif line.startswith('EXPECT_AT_MOST: '):
+            parts = line.split()
+            budgets.append([int(parts[1]), 0, parts[2:]])
+            set_expectation = True
         elif line.startswith('[') and line.endswith(')') and ('@' in line or '#' in line):
             # Wayland debug log line
             if assertions and line_contains(line, assertions[0]):
@@ -216,6 +225,14 @@ def verify_result(lines: List[str]):
                 if line_contains(line, negative_assertion):
                     section = format_stream('relevant section', '\n'.join(lines[section_start:i + 1]))
                     raise TestError(section + '\n\nunexpected message matching "' + ' '.join(negative_assertion) + '"')
+            for budget in budgets:
+                if line_contains(line, budget[2]):
+                    budget[1] += 1
+                    if budget[1] > budget[0]:
+                        section = format_stream('relevant section', '\n'.join(lines[section_start:i + 1]))
+                        raise TestError(
+                            section + '\n\nmore than ' + str(budget[0]) + ' messages matching "' +
+                            ' '.join(budget[2]) + '"')
         elif line.startswith('** (') and ':' in line:
             # glib log line
             if assertions and line_contains(line, assertions[0]):
@@ -230,94 +247,256 @@ def verify_result(lines: List[str]):
                 raise TestError(section + '\n\ndid not find "' + ' '.join(assertions[0]) + '"')
             section_start = i + 1
             negative_assertions = []
+            budgets = []
 
     if not set_expectation or not checked_expectation:
         # If the test didn't use the right expectation format or something we don't want to silently pass
         raise TestError('test did not correctly set and check an expectation')
 
-def main() -> None:
-    client_bin = sys.argv[1]
-    name = path.basename(client_bin)
-    valgrind_enabled = os.environ.get('GTKLS_VALGRIND') == '1'
-    build_dir = os.environ.get('GTKLS_BUILD_DIR')
-    if not build_dir:
-        build_dir = path.dirname(client_bin)
-        while not path.exists(path.join(build_dir, 'build.ninja')):
-            build_dir = path.dirname(build_dir)
-            assert build_dir != '' and build_dir != '/', (
-                'Could not determine build directory from GTKLS_BUILD_DIR or ' + client_bin
-            )
-    server_bin = path.join(build_dir, 'test', 'mock-server', 'mock-server')
-    assert path.exists(client_bin), 'Could not find client at ' + client_bin
-    assert os.access(client_bin, os.X_OK), client_bin + ' is not executable'
-    assert path.exists(server_bin), 'Could not find server at ' + server_bin
-    assert os.access(server_bin, os.X_OK), server_bin + ' is not executable'
-    test_dir = get_test_dir()
-
-    wayland_display = path.join(test_dir, 'gtkls-test-display')
-    env = os.environ.copy()
-    env['GTKLS_TEST_DIR'] = test_dir
-    env['XDG_RUNTIME_DIR'] = test_dir
-    env['WAYLAND_DISPLAY'] = wayland_display
-    env['WAYLAND_DEBUG'] = '1'
-    ld_lib_path = env.get('LD_LIBRARY_PATH')
-    env['LD_LIBRARY_PATH'] = (
-        path.join(build_dir, 'src') +
-        (os.pathsep + ld_lib_path if ld_lib_path else '')
-    )
-
-    server = Program('server', [server_bin], env)
+def collect_benchmark_results(lines: List[str]) -> List[Dict[str, Any]]:
+    '''Parses the BENCHMARK: lines emitted by the BENCHMARK_RESULT() macro'''
+    results: List[Dict[str, Any]] = []
+    for line in lines:
+        if line.startswith('BENCHMARK: '):
+            parts = line.split()
+            if len(parts) != 4:
+                raise TestError('invalid benchmark line: ' + line)
+            results.append({'name': parts[1], 'value': float(parts[2]), 'unit': parts[3]})
+    if not results:
+        raise TestError('benchmark did not report any results')
+    return results
+
+def parse_massif_peak(massif_out: str) -> int:
+    '''Returns the largest heap size of any snapshot in the given massif output file'''
+    peak = 0
+    with open(massif_out, 'r') as f:
+        for line in f:
+            if line.startswith('mem_heap_B='):
+                peak = max(peak, int(line.split('=')[1]))
+    if peak == 0:
+        raise TestError('no heap snapshots in ' + massif_out)
+    return peak
+
+def bytes_per_surface(peaks: Dict[int, int]) -> float:
+    '''Least squares slope of peak memory over surface count, which leaves out the fixed cost of the process'''
+    n = len(peaks)
+    mean_count = sum(peaks.keys()) / n
+    mean_peak = sum(peaks.values()) / n
+    covariance = sum((count - mean_count) * (peak - mean_peak) for count, peak in peaks.items())
+    variance = sum((count - mean_count) ** 2 for count in peaks.keys())
+    return covariance / variance
+
+def report_benchmark(name: str, results: List[Dict[str, Any]]):
+    '''Prints the results as JSON, and appends them to $GTKLS_BENCHMARK_OUTPUT (one JSON object per line) if set'''
+    report = json.dumps({'benchmark': name, 'results': results})
+    print(report)
+    output_path = os.environ.get('GTKLS_BENCHMARK_OUTPUT')
+    if output_path:
+        with open(output_path, 'a') as f:
+            f.write(report + '\n')
+
+class TestEnv:
+    '''Locates the client and server binaries and sets up the environment they run in'''
+    def __init__(self, client_bin: str, benchmark: bool):
+        self.client_bin = client_bin
+        self.name = path.basename(client_bin)
+        build_dir = os.environ.get('GTKLS_BUILD_DIR')
+        if not build_dir:
+            build_dir = path.dirname(client_bin)
+            while not path.exists(path.join(build_dir, 'build.ninja')):
+                build_dir = path.dirname(build_dir)
+                assert build_dir != '' and build_dir != '/', (
+                    'Could not determine build directory from GTKLS_BUILD_DIR or ' + client_bin
+                )
+        self.server_bin = path.join(build_dir, 'test', 'mock-server', 'mock-server')
+        assert path.exists(client_bin), 'Could not find client at ' + client_bin
+        assert os.access(client_bin, os.X_OK), client_bin + ' is not executable'
+        assert path.exists(self.server_bin), 'Could not find server at ' + self.server_bin
+        assert os.access(self.server_bin, os.X_OK), self.server_bin + ' is not executable'
+        self.test_dir = get_test_dir()
+        self.server_stderr = '' # Of the most recent run with a separate server process
+
+        self.env = os.environ.copy()
+        self.env['GTKLS_TEST_DIR'] = self.test_dir
+        self.env['XDG_RUNTIME_DIR'] = self.test_dir
+        if not benchmark:
+            # Logging every message would dominate the timings, and benchmarks don't check expectations
+            self.env['WAYLAND_DEBUG'] = '1'
+        ld_lib_path = self.env.get('LD_LIBRARY_PATH')
+        self.env['LD_LIBRARY_PATH'] = (
+            path.join(build_dir, 'src') +
+            (os.pathsep + ld_lib_path if ld_lib_path else '')
+        )
+
+    def run(
+        self,
+        client_args: List[str],
+        display_name: str,
+        timeout: float,
+        extra_env: Dict[str, str] = {},
+        in_process: bool = False
+    ) -> str:
+        '''
+        Runs the client in a fresh mock server, checks both exit cleanly and returns the client's stderr.
+        If in_process, the client runs the mock server on a thread of its own instead (see mock-server-lib.h).
+        '''
+        wayland_display = path.join(self.test_dir, display_name)
+        env = self.env.copy()
+        env['WAYLAND_DISPLAY'] = wayland_display
+        env.update(extra_env)
+
+        server: Optional[Program] = None
+        if in_process:
+            env['GTKLS_MOCK_IN_PROCESS'] = '1'
+        else:
+            server = Program('server', [self.server_bin], env)
+            try:
+                wait_until_appears(wayland_display)
+            except TestError as e:
+                server.kill()
+                raise TestError(server.format_output() + '\n\n' + str(e))
 
-    try:
-        wait_until_appears(wayland_display)
-    except TestError as e:
-        server.kill()
-        raise TestError(server.format_output() + '\n\n' + str(e))
+        client = Program(self.name, client_args + [self.client_bin, '--auto'], env)
 
-    client_args = [client_bin, '--auto']
-    if valgrind_enabled:
-        client_args = [
-            'valgrind',
-            '--exit-on-first-error=yes',
-            '--error-exitcode=' + str(valgrind_error_return_code),
-            '--quiet'
-        ] + client_args;
-    client = Program(name, client_args, env)
+        errors: List[str] = []
+        try:
+            client.finish(timeout=timeout)
+            client.check_returncode()
+        except TestError as e:
+            errors.append(str(e))
 
-    errors: List[str] = []
-    try:
-        client.finish(timeout=60)
-        client.check_returncode()
-    except TestError as e:
-        errors.append(str(e))
+        if server:
+            try:
+                server.finish(timeout=1)
+                server.check_returncode()
+            except TestError as e:
+                errors.append(str(e))
+            self.server_stderr = server.stderr.collect_str()
 
-    try:
-        server.finish(timeout=1)
-        server.check_returncode()
-    except TestError as e:
-        errors.append(str(e))
+        if errors:
+            raise TestError('\n\n'.join(errors))
+
+        client_stdout, client_stderr = client.collect_output()
+
+        if client_stdout.strip() != '':
+            raise TestError(
+                format_stream(self.name + ' stdout', client_stdout) + '\n\n' + self.name + ' stdout not empty')
 
-    if errors:
-        raise TestError('\n\n'.join(errors))
+        return client_stderr
 
-    client_stdout, client_stderr = client.collect_output()
+def main(client_bin: str, benchmark: bool, in_process: bool) -> None:
+    test_env = TestEnv(client_bin, benchmark)
+    name = test_env.name
 
-    if client_stdout.strip() != '':
-        raise TestError(format_stream(name + ' stdout', client_stdout) + '\n\n' + name + ' stdout not empty')
+    wrapper_args: List[str] = []
+    if os.environ.get('GTKLS_VALGRIND') == '1':
+        wrapper_args = [
+            'valgrind',
+            '--exit-on-first-error=yes',
+            '--error-exitcode=' + str(valgrind_error_return_code),
+            '--quiet'
+        ]
+    client_stderr = test_env.run(wrapper_args, 'gtkls-test-display', timeout=60, in_process=in_process)
 
     client_lines = [line.strip() for line in client_stderr.strip().splitlines()]
 
     try:
-        verify_result(client_lines)
+        if benchmark:
+            report_benchmark(name, collect_benchmark_results(client_lines))
+        else:
+            verify_result(client_lines)
     except TestError as e:
         raise TestError(format_stream(name + ' stderr', client_stderr) + '\n\n' + str(e))
 
+def main_record_replay(client_bin: str) -> None:
+    '''
+    Runs the client once while the mock server records the run (see mock-server/record-replay.c), then again while the
+    server replays the recording. Both runs must pass, and the server must send the same events in the replay.
+    '''
+    test_env = TestEnv(client_bin, False)
+    recording = path.join(test_env.test_dir, 'recording')
+    for display_name, extra_env in [
+        ('gtkls-test-display-record', {'GTKLS_MOCK_RECORD': recording}),
+        ('gtkls-test-display-replay', {'GTKLS_MOCK_REPLAY': recording}),
+    ]:
+        client_stderr = test_env.run([], display_name, timeout=60, extra_env=extra_env)
+        client_lines = [line.strip() for line in client_stderr.strip().splitlines()]
+        try:
+            verify_result(client_lines)
+        except TestError as e:
+            raise TestError(format_stream(test_env.name + ' stderr', client_stderr) + '\n\n' + str(e))
+    if 'Replay matched' not in test_env.server_stderr:
+        raise TestError(
+            format_stream('server stderr', test_env.server_stderr) + '\n\nserver did not report a matching replay')
+
+def main_massif(client_bin: str, budget: int) -> None:
+    '''
+    Runs the client under massif once for each surface count (passed in GTKLS_BENCHMARK_SURFACES), and fails if the
+    memory each additional surface costs is over budget. A budget of 0 only reports the cost. --pages-as-heap is used so the shm buffers GDK maps for each
+    surface are counted along with malloc'd memory.
+    '''
+    test_env = TestEnv(client_bin, True)
+    peaks: Dict[int, int] = {}
+    for count in [1, 10, 100]:
+        massif_out = path.join(test_env.test_dir, 'massif.out.' + str(count))
+        massif_args = [
+            'valgrind',
+            '--tool=massif',
+            '--pages-as-heap=yes',
+            '--massif-out-file=' + massif_out,
+            '--quiet'
+        ]
+        test_env.run(
+            massif_args,
+            'gtkls-test-display-' + str(count),
+            timeout=300,
+            extra_env={'GTKLS_BENCHMARK_SURFACES': str(count)})
+        peaks[count] = parse_massif_peak(massif_out)
+
+    per_surface = bytes_per_surface(peaks)
+    results: List[Dict[str, Any]] = [
+        {'name': 'peak/' + str(count), 'value': float(peak), 'unit': 'bytes'} for count, peak in peaks.items()
+    ]
+    results.append({'name': 'per-surface', 'value': per_surface, 'unit': 'bytes'})
+    if budget:
+        results.append({'name': 'per-surface-budget', 'value': float(budget), 'unit': 'bytes'})
+    report_benchmark(test_env.name, results)
+    if budget and per_surface > budget:
+        raise TestError(
+            test_env.name + ' uses ' + str(int(per_surface)) + ' bytes per surface, over its budget of ' +
+            str(budget) + ' (see memory_benchmarks in test/benchmarks/meson.build)')
+
 if __name__ == '__main__':
-    assert len(sys.argv) == 2, 'Incorrect number of args. ' + usage
+    args = sys.argv[1:]
+    benchmark = '--benchmark' in args
+    if benchmark:
+        args.remove('--benchmark')
+    in_process = '--in-process' in args
+    if in_process:
+        # Server log lines would get mixed into the client's WAYLAND_DEBUG output, so only benchmarks can do this
+        assert benchmark, '--in-process only works with --benchmark. ' + usage
+        args.remove('--in-process')
+    massif_budget: Optional[int] = None
+    if '--massif' in args:
+        i = args.index('--massif')
+        assert i + 1 < len(args), 'No budget given to --massif. ' + usage
+        massif_budget = int(args[i + 1])
+        del args[i:i + 2]
+    record_replay = '--record-replay' in args
+    if record_replay:
+        args.remove('--record-replay')
+    assert len(args) == 1, 'Incorrect number of args. ' + usage
     fail = False
     try:
-        main()
-        print('Passed')
+        if massif_budget is not None:
+            main_massif(args[0], massif_budget)
+        elif record_replay:
+            main_record_replay(args[0])
+            print('Passed')
+        else:
+            main(args[0], benchmark, in_process)
+            if not benchmark:
+                print('Passed')
     except TestError as e:
         fail = True
         print(e)